@@ -1,3 +1,3 @@
 #!/bin/bash
 mkdir docs
-em++ ./src/grid_map.cpp ./src/grid_tree.cpp ./src/main.cpp -I ./include --preload-file maps -sUSE_SDL=3 -Oz -o docs/index.html
+em++ ./src/grid_map.cpp ./src/grid_tree.cpp ./src/flat_grid_tree.cpp ./src/mapped_file.cpp ./src/thread_pool.cpp ./src/tiled_world.cpp ./src/framebuffer.cpp ./src/column_sampler.cpp ./src/beam_tracer.cpp ./src/frame_stats.cpp ./src/map_loader.cpp ./src/entity_tree.cpp ./src/main.cpp -I ./include -std=c++20 --preload-file maps -sUSE_SDL=3 -Oz -o docs/index.html
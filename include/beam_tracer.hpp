@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+
+#include <SDL3/SDL.h>
+
+#include "grid_cast.hpp"
+#include "grid_tree.hpp"
+#include "utils.hpp"
+
+
+// Face of a leaf seen across a run of pixel columns, without anything nearer in front of any of them
+struct FaceSpan {
+    int begin, end;  // Pixel columns [begin, end)
+    float depths[2]; // Distance along the view direction at the first and the last column
+    SDL_Color color;
+    HitFace face;
+    SDL_FPoint leaf; // Center of the leaf, as in `RayHit`
+};
+
+// View frustum of a camera, projecting the root's coordinates onto pixel columns
+struct BeamFrustum {
+    SDL_FPoint origin;
+    SDL_FPoint forward, right;
+    float angle;
+    float field; // Tangent of half the field of view
+    int columns;
+
+    BeamFrustum(SDL_FPoint origin, float angle, float fov, int columns);
+
+    // Columns whose rays cross the segment, false when it lies outside of the frustum
+    bool span(SDL_FPoint from, SDL_FPoint to, int& begin, int& end) const;
+    bool box(float x_mid, float y_mid, float half, int& begin, int& end) const;
+
+    // Distance along the view direction at which the ray of the column meets the plane of the face
+    float depth(HitFace face, float plane, int column) const;
+};
+
+/*
+ * =====[Beam tracing]=====
+ *
+ *            \##|        /
+ *             \ |  ##   /      # : leaves covering columns
+ *         ##   \|      /       . : nodes culled behind them
+ *         ..    \   ##/
+ *                \   /
+ *                 \ /
+ *                  @
+ *
+ * Traces the whole view frustum through a grid tree at once, visiting nodes front to back. Each node
+ * is projected onto the pixel columns it spans and skipped altogether once every one of those is
+ * covered by nearer faces, so that the beam only splits where it straddles the boundaries of nodes
+ * still in sight. Faces of leaves are clipped against the columns left uncovered, each remaining run
+ * being emitted as a span, so that the work per frame follows the faces seen rather than the width of
+ * the screen.
+ *
+ * Column x looks along the ray which the raycasters cast for it, at `angle + atan((2x / columns - 1) *
+ * tan(fov / 2))`, seeing the same face at the same depth. Leaves are only seen from outside.
+ */
+class BeamTracer {
+private:
+    // Columns not covered yet, exclusively
+    struct Gap {
+        int begin, end;
+    };
+
+    std::vector<Gap> gaps;
+
+public:
+    std::vector<FaceSpan> spans; // Faces seen by the last beam, front to back
+
+    void reset(int columns);
+    bool covered(int begin, int end) const;
+    bool done() const;
+
+    // Emits the face lying on the plane across the columns not covered yet, then covers them
+    void cover(int begin, int end, FaceSpan face, float plane, const BeamFrustum& frustum);
+};
+
+template <typename Cursor>
+void traceBeamNode(const Cursor& node, float x_mid, float y_mid, float half, const BeamFrustum& frustum,
+                   BeamTracer& tracer) {
+    if (tracer.done()) {
+        return;
+    }
+
+    // Culls nodes outside of the frustum or behind nearer faces, unless the camera stands within them
+    const SDL_FPoint& o = frustum.origin;
+    bool inside =
+        x_mid - half <= o.x && o.x <= x_mid + half && y_mid - half <= o.y && o.y <= y_mid + half;
+    int begin, end;
+    if (!inside && (!frustum.box(x_mid, y_mid, half, begin, end) || tracer.covered(begin, end))) {
+        return;
+    }
+
+    if (node.isLeaf()) {
+        SDL_Color color = node.color();
+        if (color.a == 0 || inside) {
+            return;
+        }
+
+        // Up to two faces are turned towards the camera, neither of them hiding the other
+        float x_low = x_mid - half;
+        float x_high = x_mid + half;
+        float y_low = y_mid - half;
+        float y_high = y_mid + half;
+
+        struct {
+            bool seen;
+            HitFace face;
+            float plane;
+            SDL_FPoint from, to;
+            float local_x, local_y;
+        } faces[4] = {
+            {o.x > x_high, HitFace::XPos, x_high, {x_high, y_low}, {x_high, y_high}, 1.0f, 0.0f},
+            {o.x < x_low, HitFace::XNeg, x_low, {x_low, y_low}, {x_low, y_high}, -1.0f, 0.0f},
+            {o.y > y_high, HitFace::YPos, y_high, {x_low, y_high}, {x_high, y_high}, 0.0f, 1.0f},
+            {o.y < y_low, HitFace::YNeg, y_low, {x_low, y_low}, {x_high, y_low}, 0.0f, -1.0f},
+        };
+
+        for (const auto& face : faces) {
+            if (!face.seen || !frustum.span(face.from, face.to, begin, end)) {
+                continue;
+            }
+
+            FaceSpan span = {.color = shadeLeaf(color, face.local_x, face.local_y),
+                             .face = face.face,
+                             .leaf = SDL_FPoint{x_mid, y_mid}};
+            tracer.cover(begin, end, span, face.plane, frustum);
+        }
+        return;
+    }
+
+    // Visits the quadrant on the camera's side first and the opposite one last, whereas the other two
+    // can't hide one another
+    bool x_near = o.x > x_mid;
+    bool y_near = o.y > y_mid;
+    const bool order[4][2] = {
+        {x_near, y_near}, {!x_near, y_near}, {x_near, !y_near}, {!x_near, !y_near}};
+
+    float quarter = half / 2.0f;
+    for (const auto& [x_pos, y_pos] : order) {
+        Cursor quadrant = node;
+        bool present = node.quadrant(mapQuadrantIndex(x_pos, y_pos), quadrant);
+        COUNT_CAST_NODE();
+        COUNT_CAST_EMPTY(!present);
+        if (present) {
+            traceBeamNode(quadrant, x_mid + (x_pos ? quarter : -quarter),
+                          y_mid + (y_pos ? quarter : -quarter), quarter, frustum, tracer);
+        }
+    }
+}
+
+// Traces the view frustum through a whole grid tree, leaving the faces seen in `tracer.spans`
+template <typename Cursor>
+void traceBeam(const Cursor& root, SDL_FPoint origin, float angle, float fov, int columns,
+               BeamTracer& tracer) {
+    tracer.reset(columns);
+    traceBeamNode(root, 0.0f, 0.0f, 1.0f, BeamFrustum(origin, angle, fov, columns), tracer);
+}
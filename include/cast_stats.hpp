@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+
+/*
+ * Counts of the work done while casting, kept per thread. Only builds defining `QUADCASTER_STATS`
+ * count anything, so that the viewer doesn't pay for the counters in its innermost loops. Counts taken
+ * on several threads are merged together, keeping the deepest of their depths. Only the casts and beam
+ * tracing count the nodes they step into, queries walking the same cursors leaving the counts be.
+ */
+struct CastStats {
+    size_t rays = 0;  // Rays cast into a tree, hence once per tile crossed in tiled worlds
+    size_t nodes = 0; // Nodes stepped into, whether descending into a quadrant or following a rope
+    size_t empty = 0; // Empty quadrants among the nodes stepped into
+    size_t depth = 0; // Deepest level stepped into, the root's being zero
+
+    void merge(const CastStats& other) {
+        this->rays += other.rays;
+        this->nodes += other.nodes;
+        this->empty += other.empty;
+        this->depth = std::max(this->depth, other.depth);
+    }
+};
+
+inline thread_local CastStats castStats;
+
+#ifdef QUADCASTER_STATS
+#define COUNT_CAST_RAYS(cast) (castStats.rays += (cast))
+#define COUNT_CAST_NODE() (castStats.nodes++)
+#define COUNT_CAST_EMPTY(absent) (castStats.empty += (absent))
+#define COUNT_CAST_DEPTH(level) (castStats.depth = std::max(castStats.depth, (size_t)(level)))
+#else
+#define COUNT_CAST_RAYS(cast) ((void)0)
+#define COUNT_CAST_NODE() ((void)0)
+#define COUNT_CAST_EMPTY(absent) ((void)0)
+#define COUNT_CAST_DEPTH(level) ((void)0)
+#endif
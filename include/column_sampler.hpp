@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "grid_tree.hpp"
+
+
+// Casts rays of the given angles into the hits, however the caller sees fit
+typedef std::function<void(std::span<const float> angles, std::span<RayHit> hits)> ColumnCaster;
+
+// Whether anything solid overlaps the inside of the triangle, as when unsure
+typedef std::function<bool(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c)> ColumnOccluder;
+
+/*
+ * Edge-adaptive subsampling of the pixel columns.
+ *
+ * Only every `stride`-th column is cast at first. Between two of those hitting the same face of the
+ * same leaf at a similar depth, with nothing solid in the triangle they span with the origin, the
+ * columns are intersected with the plane of that face straight away, arriving at the same locus as
+ * casting them through the parametric engines would, but for rounding. Columns landing off the face,
+ * as around its corners, aren't filled in. Gaps anywhere else, such as around edges and corners, are
+ * bisected by casting their middle column until every column is either cast or filled in.
+ */
+class ColumnSampler {
+private:
+    // Columns between two cast ones, exclusively
+    struct Gap {
+        size_t begin, end;
+    };
+
+    std::vector<size_t> pending;
+    std::vector<Gap> gaps;
+    std::vector<Gap> split;
+
+    std::vector<float> angles;
+    std::vector<RayHit> hits;
+
+    void castColumns(const std::vector<size_t>& columns, std::span<const float> angles,
+                     std::span<RayHit> out, const ColumnCaster& cast);
+
+public:
+    size_t stride = 1; // Casting every column
+
+    size_t cast(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                const ColumnCaster& cast, const ColumnOccluder& occluded);
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SDL3/SDL.h>
+
+
+// Moving thing drawn as a sprite, standing on the ground
+struct Entity {
+    SDL_FPoint pos = {0.0f, 0.0f};
+    float radius = 0.0f;
+    SDL_Color color = {255, 255, 255, 255};
+};
+
+// Entity within the view, as projected onto pixel columns
+struct EntityView {
+    uint32_t entity;
+    float depth;      // Along the view direction, as wall distances are
+    float column;     // Of the center
+    float half_width; // In columns
+};
+
+/*
+ * =====[Loose entity tree]=====
+ *
+ *   +---------------+
+ *   |  . . . . . .  |     Every cell of the quadtree is loosened to twice its side, so that an entity
+ *   |  . +-----+ .  |     only ever sits in the one cell of its center, at the deepest level whose
+ *   |  . |  o  | .  |     cells are at least as wide as the entity. Moving it is a matter of
+ *   |  . +-----+ .  |     computing that cell again, relinking it only once its center leaves.
+ *   |  . . . . . .  |
+ *   +---------------+
+ *
+ * Companion of the grid tree for moving things rather than blocks, over the same coordinates. Levels
+ * are dense grids of cells, each heading a doubly linked list of the entities in it and counting those
+ * below it, so that queries skip over empty parts of the tree. Entities beyond the root sit in it.
+ */
+class EntityTree {
+private:
+    struct Link {
+        uint32_t prev;
+        uint32_t next;
+        uint32_t cell; // Index into the cells of every level laid out one after another
+        uint8_t level;
+    };
+
+    std::vector<Entity> entities;
+    std::vector<Link> links;
+
+    // Heads of the lists and counts of the entities below, of every cell level by level
+    std::vector<uint32_t> heads;
+    std::vector<uint32_t> counts;
+    std::vector<size_t> level_starts;
+    int depth;
+
+public:
+    EntityTree(int depth = 8);
+
+    size_t size() const;
+    const Entity& get(uint32_t id) const;
+
+    uint32_t add(const Entity& entity);
+    void move(uint32_t id, SDL_FPoint pos);
+
+    // Entities overlapping the circle, in no particular order
+    void queryCircle(SDL_FPoint center, float radius, std::vector<uint32_t>& out) const;
+
+    // Entities within the view of `columns` pixel columns and closer than `far`, nearest first
+    void queryFrustum(SDL_FPoint origin, float angle, float fov, int columns, float far,
+                      std::vector<EntityView>& out) const;
+
+private:
+    void locate(const Entity& entity, uint8_t& level, uint32_t& cell) const;
+    void link(uint32_t id);
+    void unlink(uint32_t id);
+
+    template <typename Overlaps, typename Visit>
+    void walk(int level, uint32_t x, uint32_t y, const Overlaps& overlaps, const Visit& visit) const;
+};
+
+// Drops the views hidden behind the walls of every column they span, given the depth of each column's
+// wall, returning how many were dropped
+size_t cullOccluded(std::vector<EntityView>& views, std::span<const float> depths);
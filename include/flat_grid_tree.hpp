@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "grid_tree.hpp"
+
+
+/*
+ * =====[Node of the flat grid tree]=====
+ *
+ *  31 30                                    0
+ * +--+---------------------------------------+
+ * |L |  leaf: palette index, else: children  |
+ * +--+---------------------------------------+
+ *
+ * Leaves have the L bit set and store an index into `GRID_PALETTE`. Branches store the index of the
+ * first of their four children, which are laid out contiguously in `mapQuadrantIndex` order. Empty
+ * quadrants are leaves of palette zero.
+ *
+ * Built sharing subtrees, every distinct block of four children is only laid out once, for branches
+ * alike to all refer to it, turning the tree into a DAG. Blocks still come after every branch referring
+ * to them, being laid out from the tallest subtrees down.
+ */
+typedef uint32_t FlatGridNode;
+
+const FlatGridNode FLAT_LEAF = 0x80000000u;
+
+/*
+ * =====[Ropes of the flat grid tree]=====
+ *
+ *   +-------+---+---+
+ *   |       | c | d |      a:  X+ -> (c d f g), Y- -> b
+ *   |   a   +---+---+      f:  X- -> a, X+ -> g, Y+ -> c, Y- -> e
+ *   |       | f | g |      e:  X- -> b, Y+ -> (c d f g)
+ *   +-------+---+---+
+ *   |       |       |
+ *   |   b   |   e   |
+ *   |       |       |
+ *   +-------+-------+
+ *
+ * Every node, empty quadrants included, links each of its faces to the smallest node beyond it which
+ * spans the whole face, or to `FLAT_NO_ROPE` at the bounds of the grid. A ray leaving a leaf follows
+ * the rope of the face it crossed, then descends from there, never going back up to a shared ancestor.
+ */
+struct FlatRopes {
+    uint32_t faces[4]; // X+, X-, Y+ and Y-
+    uint32_t depth;    // Levels below the root, telling the size of the node
+};
+
+const uint32_t FLAT_NO_ROPE = 0xFFFFFFFFu;
+
+/*
+ * =====[Flat grid tree file]=====
+ *
+ * +--------+---------+---------+-------+--------+-------+----------+-------------------------+
+ * | magic  | version | palette | width | height | count | checksum | nodes (count x 4 bytes) |
+ * +--------+---------+---------+-------+--------+-------+----------+-------------------------+
+ *    4 B      2 B       2 B      4 B     4 B      4 B      4 B
+ *
+ * Every field is little-endian. The nodes follow the header as they are laid out in memory, so that the
+ * file is cast through straight from its mapped pages. The checksum is FNV-1a over the node words, and
+ * the palette is the size of `GRID_PALETTE` the leaves index into.
+ */
+struct FlatGridFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t palette;
+    uint32_t width;
+    uint32_t height;
+    uint32_t count;
+    uint32_t checksum;
+};
+
+const uint32_t FLAT_FILE_MAGIC = 0x54434451u; // "QDCT"
+const uint16_t FLAT_FILE_VERSION = 1;
+
+class FlatGridTree {
+private:
+    // Nodes are immutable once built, hence shared between copies along with whatever owns them,
+    // either a vector built in memory or a mapped file
+    std::shared_ptr<const void> storage;
+    std::span<const FlatGridNode> nodes;
+
+    // Ropes of every node by its index, once linked by `rope`
+    std::shared_ptr<const std::vector<FlatRopes>> ropes;
+
+    // Whether blocks of children are referred to more than once
+    bool sharing = false;
+
+    // Node handle for `castSubgrid`
+    struct Cursor;
+
+    // Distinct blocks of children, built upon sharing subtrees
+    struct SharedBlocks;
+
+public:
+    // Dimensions of the source map in blocks, if known
+    size_t width = 0;
+    size_t height = 0;
+
+    FlatGridTree();
+    FlatGridTree(const GridTree& tree, bool share = false);
+
+    bool load(const std::string& file_name);
+    bool save(const std::string& file_name) const;
+
+    // Writes the nodes as a C++ header defining a `StaticGridTree` called `name`, made from `source`
+    bool saveHeader(const std::string& file_name, const std::string& name,
+                    const std::string& source) const;
+
+    size_t size() const;
+    size_t bytes() const;
+    bool empty() const;
+
+    // Whether any block of children is shared between branches
+    bool shared() const;
+
+    // Links every node to its neighbors, for `CastEngine::Roped` to walk along, which shared trees
+    // can't have as a block sits next to other nodes wherever it is referred to
+    bool rope();
+    bool roped() const;
+    size_t ropeBytes() const;
+
+    RayHit cast(SDL_FPoint origin, float angle, CastEngine engine = CastEngine::Recursive) const;
+    void castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                   CastEngine engine = CastEngine::Parametric) const;
+    void traceBeam(SDL_FPoint origin, float angle, float fov, int columns, BeamTracer& tracer) const;
+
+    // Spatial queries as on `GridTree`
+    bool solidAt(SDL_FPoint point) const;
+    bool overlapsBox(QueryBox box) const;
+    bool overlapsCircle(SDL_FPoint center, float radius) const;
+    bool overlapsTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) const;
+    SolidHit nearestSolid(SDL_FPoint point, float radius) const;
+    void solidAtBatch(std::span<const SDL_FPoint> points, std::span<uint8_t> out,
+                      ThreadPool* pool = nullptr) const;
+    void overlapsBoxBatch(std::span<const QueryBox> boxes, std::span<uint8_t> out,
+                          ThreadPool* pool = nullptr) const;
+    void overlapsCircleBatch(std::span<const SDL_FPoint> centers, float radius, std::span<uint8_t> out,
+                             ThreadPool* pool = nullptr) const;
+    void nearestSolidBatch(std::span<const SDL_FPoint> points, float radius, std::span<SolidHit> out,
+                           ThreadPool* pool = nullptr) const;
+
+    // Segment casts and sight as on `GridTree`
+    RayHit castSegment(SDL_FPoint from, SDL_FPoint to) const;
+    bool lineOfSight(SDL_FPoint from, SDL_FPoint to) const;
+    void lineOfSight(std::span<const SightPair> pairs, std::span<uint8_t> out,
+                     ThreadPool* pool = nullptr) const;
+    void lineOfSight(std::span<const SDL_FPoint> viewers, std::span<const SDL_FPoint> targets,
+                     std::span<uint8_t> out, ThreadPool* pool = nullptr) const;
+
+    TreeStats stats() const;
+    static TreeStats stats(std::span<const FlatGridNode> nodes);
+    std::string graphviz() const;
+
+private:
+    RayHit castRoped(SDL_FPoint origin, SDL_FPoint direction) const;
+    std::string graphviz(FlatGridNode node, int& i, std::vector<int>& printed) const;
+};
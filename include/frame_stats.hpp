@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include <SDL3/SDL.h>
+
+#include "cast_stats.hpp"
+#include "grid_tree.hpp"
+
+
+// Parts of a frame timed on their own, in the order they happen
+enum class FramePhase { Cast, Draw, Present };
+
+// Frames drawn over a period
+struct FrameSummary {
+    size_t frames = 0;
+    double fps = 0.0;
+    double phase_ms[3] = {0.0, 0.0, 0.0}; // Per frame on average, indexed by `FramePhase`
+    CastStats casts;                       // Totals over all of the frames
+};
+
+/*
+ * Counts and timings of the frames drawn, summed over a period and then averaged, so that they stay
+ * readable on screen and cheap to print. Casts running on any thread gather their counts in once done,
+ * which only builds defining `QUADCASTER_STATS` take at all, timings being taken regardless.
+ */
+class FrameStats {
+private:
+    std::mutex mutex;
+    CastStats casts;
+    double phase_ms[3] = {0.0, 0.0, 0.0};
+    size_t frames = 0;
+
+    Uint64 period_start = 0;
+    Uint64 phase_start = 0;
+
+public:
+    double period = 1.0; // In seconds
+    FrameSummary summary; // Of the last period over
+
+    // Starts timing the first phase of a frame
+    void begin();
+
+    // Adds the time since the last phase ended to the given one
+    void time(FramePhase phase);
+
+    // Adds the counts taken on the calling thread, from any thread
+    void gather(const CastStats& counts);
+
+    // Counts a frame in, summarizing the period once it is over
+    bool endFrame();
+
+    // Summary of the last period, along with the shape of the tree cast through if given
+    std::string json(const TreeStats* tree) const;
+    void draw(SDL_Renderer* renderer, float x, float y, const TreeStats* tree) const;
+};
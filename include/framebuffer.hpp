@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <SDL3/SDL.h>
+
+
+/*
+ * CPU-side frame of sky, wall columns and ground, meant to be written straight into a streaming
+ * texture of `SDL_PIXELFORMAT_XRGB8888`.
+ *
+ * Walls are recorded per column first, then the frame is filled row by row, so that every row is a
+ * contiguous run of pixels choosing between the wall and the backdrop in SIMD. Disjoint ranges of rows
+ * may be rendered concurrently.
+ */
+class Framebuffer {
+private:
+    // Rows of the wall in each column, spanning [top, bottom)
+    std::vector<int32_t> tops;
+    std::vector<int32_t> bottoms;
+    std::vector<uint32_t> colors;
+
+public:
+    int width = 0;
+    int height = 0;
+
+    void resize(int width, int height);
+
+    void setColumn(int x, float top, float bottom, SDL_Color color);
+    void clearColumn(int x);
+
+    void render(uint32_t* pixels, int pitch, SDL_Color sky, SDL_Color ground, int y_start,
+                int y_end) const;
+};
+
+static inline uint32_t packXRGB(const SDL_Color& color) {
+    return (uint32_t)color.r << 16 | (uint32_t)color.g << 8 | (uint32_t)color.b;
+}
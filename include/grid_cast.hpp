@@ -0,0 +1,856 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "cast_stats.hpp"
+#include "grid_tree.hpp"
+#include "simd.hpp"
+#include "utils.hpp"
+
+
+static inline SDL_Color shadeLeaf(SDL_Color color, float x, float y) {
+    // Takes the local coordinates of the ray locus in the leaf
+    bool isAtRight = x + y > 0 && x - y > 0;
+    bool isAtLeft = x + y < 0 && x - y < 0;
+
+    // Ambient shading for the sides facing X+ and X-
+    if (isAtRight || isAtLeft) {
+        color.r = (uint8_t)(color.r * 0.95);
+        color.g = (uint8_t)(color.g * 0.95);
+        // Blue is left untouched for a colder color.
+    }
+
+    return color;
+}
+
+static inline HitFace leafFace(float x, float y) {
+    // Takes the local coordinates of the ray locus in the leaf, split along its diagonals as shaded
+    if (x + y > 0) {
+        return x - y > 0 ? HitFace::XPos : HitFace::YPos;
+    }
+    else {
+        return x - y < 0 ? HitFace::XNeg : HitFace::YNeg;
+    }
+}
+
+/*
+ * Recursive raycasting shared by every grid tree representation.
+ *
+ * `Cursor` is a lightweight handle to a node of the tree, providing:
+ * - `bool isLeaf() const`
+ * - `SDL_Color color() const`
+ * - `bool quadrant(size_t index, Cursor& out) const`, yielding false upon an empty quadrant
+ * - `float clearance(size_t index) const`, the fraction of the side of an empty quadrant by which it
+ *   grows on every side without reaching a block, only used by the parametric casts
+ */
+template <typename Cursor>
+RayHit castSubgrid(const Cursor& tree, SDL_FPoint origin, float angle, int depth = 0) {
+    COUNT_CAST_DEPTH(depth);
+
+    float x = origin.x;
+    float y = origin.y;
+
+    // Vector of ray angle
+    float dx = std::sin(angle);
+    float dy = std::cos(angle);
+
+    // Performs DDA for anything exceeding the top boundary
+    if (y > 1.0) {
+        float d = (1.0 - y) / dy;
+        if (dy == 0.0 || d < 0.0) {
+            return RayHit{.hit = false, .locus = origin};
+        }
+
+        x += d * dx;
+        y = 1.0;
+    }
+
+    // Performs DDA for anything exceeding the right boundary
+    if (x > 1.0) {
+        float d = (1.0 - x) / dx;
+        if (dx == 0.0 || d < 0.0) {
+            return RayHit{.hit = false, .locus = origin};
+        }
+
+        x = 1.0;
+        y += d * dy;
+    }
+
+    // Performs DDA for anything exceeding the bottom boundary
+    if (y < -1.0) {
+        float d = (-1.0 - y) / dy;
+        if (dy == 0.0 || d < 0.0) {
+            return RayHit{.hit = false, .locus = origin};
+        }
+
+        x += d * dx;
+        y = -1.0;
+    }
+
+    // Performs DDA for anything exceeding the left boundary
+    if (x < -1.0) {
+        float d = (-1.0 - x) / dx;
+        if (dx == 0.0 || d < 0.0) {
+            return RayHit{.hit = false, .locus = origin};
+        }
+
+        x = -1.0;
+        y += d * dy;
+    }
+
+    // If it's inside a leaf tree, confirms ray hit success
+    if (tree.isLeaf()) {
+        return RayHit{.hit = true,
+                      .locus = SDL_FPoint{x, y},
+                      .color = shadeLeaf(tree.color(), x, y),
+                      .face = leafFace(x, y)};
+    }
+
+    // Loops while still being in the bounds of the grid
+    while (-1.0 <= x && x <= 1.0 && -1.0 <= y && y <= 1.0) {
+        // Defines the bounds of the current subgrid relative to the grid's coordinates
+        float x_min, x_max, y_min, y_max;
+        if (x >= 0.0) {
+            if (y >= 0.0) {
+                x_min = 0.0;
+                x_max = 1.0;
+                y_min = 0.0;
+                y_max = 1.0;
+            }
+            else {
+                x_min = 0.0;
+                x_max = 1.0;
+                y_min = -1.0;
+                y_max = 0.0;
+            }
+        }
+        else {
+            if (y >= 0.0) {
+                x_min = -1.0;
+                x_max = 0.0;
+                y_min = 0.0;
+                y_max = 1.0;
+            }
+            else {
+                x_min = -1.0;
+                x_max = 0.0;
+                y_min = -1.0;
+                y_max = 0.0;
+            }
+        }
+
+        // If a tree is present in the subgrid
+        Cursor quadrant;
+        bool present = tree.quadrant(mapQuadrantIndex(x >= 0.0, y >= 0.0), quadrant);
+        COUNT_CAST_NODE();
+        COUNT_CAST_EMPTY(!present);
+        if (present) {
+            // Maps the current grid coordinates to the local subgrid coordinates
+            SDL_FPoint local;
+            local.x = remap(x, x_min, x_max, -1.0, 1.0);
+            local.y = remap(y, y_min, y_max, -1.0, 1.0);
+
+            // Recurses into the subgrid
+            RayHit ray = castSubgrid(quadrant, local, angle, depth + 1);
+
+            // Maps back the local subgrid coordinates to the current grid coordinates
+            x = ray.locus.x = remap(ray.locus.x, -1.0, 1.0, x_min, x_max);
+            y = ray.locus.y = remap(ray.locus.y, -1.0, 1.0, y_min, y_max);
+
+            // Finally returns upon a successful ray hit
+            if (ray.hit) {
+                ray.leaf.x = remap(ray.leaf.x, -1.0, 1.0, x_min, x_max);
+                ray.leaf.y = remap(ray.leaf.y, -1.0, 1.0, y_min, y_max);
+                return ray;
+            }
+        }
+        // If no tree is in the subgrid, projects a line shooting through the other side of the subgrid
+        else {
+            // Angles relative to (x, y) for each vertex of the empty grid
+            float top_left = std::atan2(x_min - x, y_max - y);
+            float top_right = std::atan2(x_max - x, y_max - y);
+            float bottom_left = std::atan2(x_min - x, y_min - y);
+            float bottom_right = std::atan2(x_max - x, y_min - y);
+
+            // If projecting to the top side
+            if (betweenAngle(angle, top_left, top_right)) {
+                // DDA for the perpendicular X axis
+                x += (y_max - y) / dy * dx;
+
+                // Nudges inside, ensuring it's within the bounds of the top neighbor
+                y = y_max + EPSILON;
+            }
+            // If projecting to the right side
+            else if (betweenAngle(angle, top_right, bottom_right)) {
+                // DDA for the perpendicular Y axis
+                y += (x_max - x) / dx * dy;
+
+                // Nudges inside, ensuring it's within the bounds of the right neighbor
+                x = x_max + EPSILON;
+            }
+            // If projecting to the bottom side
+            else if (betweenAngle(angle, bottom_right, bottom_left)) {
+                // DDA for the perpendicular X axis
+                x += (y_min - y) / dy * dx;
+
+                // Nudges inside, ensuring it's within the bounds of the bottom neighbor
+                y = y_min - EPSILON;
+            }
+            // If projecting to the left side
+            else if (betweenAngle(angle, bottom_left, top_left)) {
+                // DDA for the perpendicular Y axis
+                y += (x_min - x) / dx * dy;
+
+                // Nudges inside, ensuring it's within the bounds of the left neighbor
+                x = x_min - EPSILON;
+            }
+        }
+    }
+
+    // Exits the grid tree without hitting anything
+    return RayHit{.hit = false, .locus = SDL_FPoint{x, y}};
+}
+
+// Whether a coordinate lies within [from, to], leaning towards the direction of travel at the ends
+static inline bool withinLeaning(float x, float d, float from, float to) {
+    if (d > 0.0f) {
+        return from <= x && x < to;
+    }
+    else if (d < 0.0f) {
+        return from < x && x <= to;
+    }
+    else {
+        return from <= x && x <= to;
+    }
+}
+
+// Clips a ray to the slabs of the whole grid, yielding false if it never enters the grid
+static inline bool clipToGrid(SDL_FPoint origin, SDL_FPoint direction, SDL_FPoint inverse,
+                              float& t_enter, float& t_exit) {
+    if (direction.x != 0.0f) {
+        float t0 = (-1.0f - origin.x) * inverse.x;
+        float t1 = (1.0f - origin.x) * inverse.x;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
+    }
+    else if (origin.x < -1.0f || origin.x > 1.0f) {
+        return false;
+    }
+    if (direction.y != 0.0f) {
+        float t0 = (-1.0f - origin.y) * inverse.y;
+        float t1 = (1.0f - origin.y) * inverse.y;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
+    }
+    else if (origin.y < -1.0f || origin.y > 1.0f) {
+        return false;
+    }
+
+    return t_enter <= t_exit;
+}
+
+// Deepest tree the stacks of the parametric casts hold, the root being at depth zero
+const int MAX_CAST_DEPTH = 63;
+
+// Subgrid in the root's coordinates, as kept on the stack of `castParametric`
+template <typename Cursor>
+struct CastSubgrid {
+    Cursor tree;
+    float x_mid, y_mid, half;
+};
+
+/*
+ * Subgrids containing a point from the root down, located once for every cast from that point. The
+ * descent stops at a split which the point lies on, where the quadrant to go on into depends on the
+ * direction of each ray. An empty quadrant reached instead is kept as the open space around the point.
+ */
+template <typename Cursor>
+struct CastOrigin {
+    SDL_FPoint point;
+    CastSubgrid<Cursor> stack[MAX_CAST_DEPTH + 1];
+    int top;
+    SDL_FPoint open_low, open_high;
+};
+
+template <typename Cursor>
+void locateOrigin(const Cursor& root, SDL_FPoint point, CastOrigin<Cursor>& out) {
+    out.point = point;
+    out.top = 0;
+    out.open_low = {INF, INF};
+    out.open_high = {-INF, -INF};
+    out.stack[0] = CastSubgrid<Cursor>{root, 0.0f, 0.0f, 1.0f};
+    if (point.x < -1.0f || 1.0f < point.x || point.y < -1.0f || 1.0f < point.y) {
+        return;
+    }
+
+    CastSubgrid<Cursor> current = out.stack[0];
+    while (!current.tree.isLeaf() && point.x != current.x_mid && point.y != current.y_mid) {
+        bool x_pos = point.x > current.x_mid;
+        bool y_pos = point.y > current.y_mid;
+
+        float half = current.half / 2.0f;
+        CastSubgrid<Cursor> quadrant = {current.tree, current.x_mid + (x_pos ? half : -half),
+                                        current.y_mid + (y_pos ? half : -half), half};
+        COUNT_CAST_NODE();
+        if (!current.tree.quadrant(mapQuadrantIndex(x_pos, y_pos), quadrant.tree)) {
+            COUNT_CAST_EMPTY(true);
+            out.open_low = {quadrant.x_mid - half, quadrant.y_mid - half};
+            out.open_high = {quadrant.x_mid + half, quadrant.y_mid + half};
+            return;
+        }
+
+        out.stack[++out.top] = current = quadrant;
+        COUNT_CAST_DEPTH(out.top);
+    }
+}
+
+/*
+ * Iterative raycasting shared by every grid tree representation, using the same `Cursor` as
+ * `castSubgrid`.
+ *
+ * The ray is parametrized as `origin + t * direction`. Instead of remapping coordinates per level, the
+ * traversal keeps an explicit stack of the subgrids containing the current locus, all in the root's
+ * coordinates. Empty quadrants are crossed by comparing the `t` at which each slab is left, using the
+ * reciprocal of the direction computed once. Boundaries are landed on exactly, with the neighbor
+ * chosen by the sign of the direction rather than an `EPSILON` nudge.
+ *
+ * Rays from an origin located beforehand start off from its subgrids rather than the root.
+ *
+ * Given a footprint, the side of a node which projects onto a pixel at a distance of one, the descent
+ * stops at branches narrower than the footprint at the distance reached. Such a branch is hit with the
+ * representative color of its blocks however little of it they cover, lest thin walls vanish from
+ * afar, thus only for cursors whose branches carry such a color.
+ *
+ * Otherwise, an empty quadrant with any clearance is left along with the open space around it at once,
+ * landing past it in the open rather than on its face. Leaves are still hit on the face of the empty
+ * quadrant before them, with the locus computed from the origin as without skipping.
+ */
+template <typename Cursor>
+RayHit castParametric(const Cursor& root, SDL_FPoint origin, SDL_FPoint direction, float t_max = INF,
+                      const CastOrigin<Cursor>* from = nullptr, float footprint = 0.0f) {
+    typedef CastSubgrid<Cursor> Subgrid;
+
+    float dx = direction.x;
+    float dy = direction.y;
+    float inv_dx = 1.0f / dx;
+    float inv_dy = 1.0f / dy;
+
+    auto contains = [&](const Subgrid& grid, float x, float y) {
+        return withinLeaning(x, dx, grid.x_mid - grid.half, grid.x_mid + grid.half) &&
+               withinLeaning(y, dy, grid.y_mid - grid.half, grid.y_mid + grid.half);
+    };
+
+    // Slab entry and exit of the whole grid
+    float t_enter = 0.0f;
+    float t_exit = t_max;
+    if (!clipToGrid(origin, direction, SDL_FPoint{inv_dx, inv_dy}, t_enter, t_exit)) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+
+    // Locus on entry, clamped onto the grid against rounding
+    float t = t_enter;
+    float x = std::clamp(origin.x + t * dx, -1.0f, 1.0f);
+    float y = std::clamp(origin.y + t * dy, -1.0f, 1.0f);
+
+    Subgrid stack[MAX_CAST_DEPTH + 1];
+    int top = 0;
+    stack[0] = Subgrid{root, 0.0f, 0.0f, 1.0f};
+    if (from && t_enter == 0.0f) {
+        top = from->top;
+        std::copy(from->stack, from->stack + top + 1, stack);
+    }
+
+    while (true) {
+        // Descends into the quadrants containing the locus until reaching a leaf or an empty quadrant
+        Subgrid current = stack[top];
+        bool empty = false;
+        bool coarse = false;
+        float grow = 0.0f;
+        while (!current.tree.isLeaf()) {
+            // Stands in for branches below the footprint by their color, the root aside
+            if (top > 0 && current.half * 2.0f < footprint * t) {
+                coarse = true;
+                break;
+            }
+
+            bool x_pos = x > current.x_mid || (x == current.x_mid && dx >= 0.0f);
+            bool y_pos = y > current.y_mid || (y == current.y_mid && dy >= 0.0f);
+
+            float half = current.half / 2.0f;
+            Subgrid quadrant = {current.tree, current.x_mid + (x_pos ? half : -half),
+                                current.y_mid + (y_pos ? half : -half), half};
+            size_t index = mapQuadrantIndex(x_pos, y_pos);
+            COUNT_CAST_NODE();
+            if (!current.tree.quadrant(index, quadrant.tree)) {
+                COUNT_CAST_EMPTY(true);
+                grow = footprint > 0.0f ? 0.0f : current.tree.clearance(index) * current.half;
+                current = quadrant;
+                empty = true;
+                break;
+            }
+
+            stack[++top] = current = quadrant;
+            COUNT_CAST_DEPTH(top);
+        }
+
+        // Confirms ray hit success upon reaching a leaf, or a branch too narrow to tell apart
+        if (!empty) {
+            float local_x = (x - current.x_mid) / current.half;
+            float local_y = (y - current.y_mid) / current.half;
+            SDL_Color color = current.tree.color();
+            color.a = coarse ? 255 : color.a;
+            return RayHit{.hit = true,
+                          .locus = SDL_FPoint{x, y},
+                          .color = shadeLeaf(color, local_x, local_y),
+                          .face = leafFace(local_x, local_y),
+                          .leaf = SDL_FPoint{current.x_mid, current.y_mid}};
+        }
+
+        // Parameters at which the ray leaves the slabs of the empty quadrant
+        float x_bound = current.x_mid + (dx >= 0.0f ? current.half : -current.half);
+        float y_bound = current.y_mid + (dy >= 0.0f ? current.half : -current.half);
+        float t_x = dx != 0.0f ? (x_bound - origin.x) * inv_dx : INF;
+        float t_y = dy != 0.0f ? (y_bound - origin.y) * inv_dy : INF;
+
+        // Leaves the open space around the quadrant instead when it has been measured, past its slabs
+        if (grow > 0.0f) {
+            t_x = dx != 0.0f ? (x_bound + (dx >= 0.0f ? grow : -grow) - origin.x) * inv_dx : INF;
+            t_y = dy != 0.0f ? (y_bound + (dy >= 0.0f ? grow : -grow) - origin.y) * inv_dy : INF;
+        }
+
+        // Never steps backwards, even if rounding says so
+        t = std::max(t, std::min(t_x, t_y));
+        if (t >= t_exit) {
+            t = t_exit;
+            break;
+        }
+
+        // Lands in the open, clamped onto the grid against rounding
+        if (grow > 0.0f) {
+            x = std::clamp(origin.x + t * dx, -1.0f, 1.0f);
+            y = std::clamp(origin.y + t * dy, -1.0f, 1.0f);
+        }
+        // Lands exactly on the crossed boundary, kept on the face of the quadrant against rounding,
+        // lest the locus slip back into the subgrid it came from when passing close to a corner
+        else {
+            float x_low = current.x_mid - current.half;
+            float x_high = current.x_mid + current.half;
+            float y_low = current.y_mid - current.half;
+            float y_high = current.y_mid + current.half;
+            if (t_x <= t_y) {
+                x = x_bound;
+                y = std::clamp(origin.y + t * dy, y_low, y_high);
+            }
+            if (t_y <= t_x) {
+                x = t_x == t_y ? x_bound : std::clamp(origin.x + t * dx, x_low, x_high);
+                y = y_bound;
+            }
+        }
+
+        // Leaves the subgrids no longer containing the locus
+        while (top >= 0 && !contains(stack[top], x, y)) {
+            top--;
+        }
+        if (top < 0) {
+            break;
+        }
+    }
+
+    // Exits the grid tree without hitting anything
+    return RayHit{.hit = false, .locus = SDL_FPoint{origin.x + t * dx, origin.y + t * dy}};
+}
+
+/*
+ * Packet raycasting of `FloatPacket::WIDTH` rays sharing the same origin, following `castParametric`.
+ *
+ * The rays traverse the tree together while every one of them lies in the same quadrant, with their
+ * slab parameters computed as a single packet. Rays diverging into a different quadrant carry on one by
+ * one through `castParametric`, starting from where they left the packet. The open space around empty
+ * quadrants is skipped for the whole packet at once, as by `castParametric`.
+ */
+template <typename Cursor>
+void castPacket(const Cursor& root, SDL_FPoint origin, const SDL_FPoint* directions, RayHit* out) {
+    const int WIDTH = FloatPacket::WIDTH;
+    struct Subgrid {
+        Cursor tree;
+        float x_mid, y_mid, half;
+    };
+
+    // Rays entering the grid from outside rarely share quadrants, hence are cast separately
+    if (origin.x < -1.0f || origin.x > 1.0f || origin.y < -1.0f || origin.y > 1.0f) {
+        for (int i = 0; i < WIDTH; i++) {
+            out[i] = castParametric(root, origin, directions[i]);
+        }
+        return;
+    }
+
+    float lanes_dx[WIDTH], lanes_dy[WIDTH], lanes_inv_dx[WIDTH], lanes_inv_dy[WIDTH];
+    for (int i = 0; i < WIDTH; i++) {
+        lanes_dx[i] = directions[i].x;
+        lanes_dy[i] = directions[i].y;
+        lanes_inv_dx[i] = 1.0f / directions[i].x;
+        lanes_inv_dy[i] = 1.0f / directions[i].y;
+    }
+
+    FloatPacket zero = 0.0f;
+    FloatPacket infinity = INF;
+    FloatPacket ox = origin.x;
+    FloatPacket oy = origin.y;
+    FloatPacket dx = FloatPacket::load(lanes_dx);
+    FloatPacket dy = FloatPacket::load(lanes_dy);
+    FloatPacket inv_dx = FloatPacket::load(lanes_inv_dx);
+    FloatPacket inv_dy = FloatPacket::load(lanes_inv_dy);
+    FloatPacket x_forward = zero <= dx;
+    FloatPacket y_forward = zero <= dy;
+    FloatPacket x_still = dx == zero;
+    FloatPacket y_still = dy == zero;
+
+    // Parameters at which the rays leave the slabs of a subgrid, towards their direction of travel
+    auto exitX = [&](FloatPacket bound) { return select(x_still, infinity, (bound - ox) * inv_dx); };
+    auto exitY = [&](FloatPacket bound) { return select(y_still, infinity, (bound - oy) * inv_dy); };
+
+    // Whether the rays lie within a subgrid, leaning towards their direction of travel at the ends
+    auto within = [](FloatPacket x, FloatPacket d, float from, float to) {
+        FloatPacket zero = 0.0f;
+        FloatPacket lower = (FloatPacket(from) < x) | ((FloatPacket(from) == x) & (zero <= d));
+        FloatPacket upper = (x < FloatPacket(to)) | ((x == FloatPacket(to)) & (d <= zero));
+        return lower & upper;
+    };
+    auto contains = [&](const Subgrid& grid, FloatPacket x, FloatPacket y) {
+        return mask(within(x, dx, grid.x_mid - grid.half, grid.x_mid + grid.half) &
+                    within(y, dy, grid.y_mid - grid.half, grid.y_mid + grid.half));
+    };
+
+    FloatPacket t = zero;
+    FloatPacket t_exit =
+        min(exitX(select(x_forward, 1.0f, -1.0f)), exitY(select(y_forward, 1.0f, -1.0f)));
+    FloatPacket x = ox;
+    FloatPacket y = oy;
+    uint32_t active = (1u << WIDTH) - 1;
+
+    Subgrid stack[MAX_CAST_DEPTH + 1];
+    int top = 0;
+    stack[0] = Subgrid{root, 0.0f, 0.0f, 1.0f};
+
+    while (active) {
+        float lanes_x[WIDTH], lanes_y[WIDTH];
+        x.store(lanes_x);
+        y.store(lanes_y);
+
+        // Descends into the quadrants containing the locus of the leading ray
+        int lead = __builtin_ctz(active);
+        Subgrid current = stack[top];
+        bool empty = false;
+        float grow = 0.0f;
+        while (!current.tree.isLeaf()) {
+            float x_lead = lanes_x[lead];
+            float y_lead = lanes_y[lead];
+            bool x_pos = x_lead > current.x_mid || (x_lead == current.x_mid && lanes_dx[lead] >= 0.0f);
+            bool y_pos = y_lead > current.y_mid || (y_lead == current.y_mid && lanes_dy[lead] >= 0.0f);
+
+            float half = current.half / 2.0f;
+            Subgrid quadrant = {current.tree, current.x_mid + (x_pos ? half : -half),
+                                current.y_mid + (y_pos ? half : -half), half};
+            size_t index = mapQuadrantIndex(x_pos, y_pos);
+            COUNT_CAST_NODE();
+            if (!current.tree.quadrant(index, quadrant.tree)) {
+                COUNT_CAST_EMPTY(true);
+                grow = current.tree.clearance(index) * current.half;
+                current = quadrant;
+                empty = true;
+                break;
+            }
+
+            stack[++top] = current = quadrant;
+            COUNT_CAST_DEPTH(top);
+        }
+
+        // Lets the rays which diverged from the leading one carry on by themselves
+        uint32_t diverged = active & ~contains(current, x, y);
+        for (int i = 0; i < WIDTH; i++) {
+            if (diverged & (1u << i)) {
+                out[i] = castParametric(root, SDL_FPoint{lanes_x[i], lanes_y[i]}, directions[i]);
+            }
+        }
+        active &= ~diverged;
+        if (!active) {
+            break;
+        }
+
+        // Confirms ray hit success upon reaching a leaf
+        if (!empty) {
+            for (int i = 0; i < WIDTH; i++) {
+                if (active & (1u << i)) {
+                    float local_x = (lanes_x[i] - current.x_mid) / current.half;
+                    float local_y = (lanes_y[i] - current.y_mid) / current.half;
+                    out[i] = RayHit{.hit = true,
+                                    .locus = SDL_FPoint{lanes_x[i], lanes_y[i]},
+                                    .color = shadeLeaf(current.tree.color(), local_x, local_y),
+                                    .face = leafFace(local_x, local_y),
+                                    .leaf = SDL_FPoint{current.x_mid, current.y_mid}};
+                }
+            }
+            return;
+        }
+
+        // Steps every ray through the slabs of the empty quadrant at once
+        FloatPacket x_bound = current.x_mid + select(x_forward, current.half, -current.half);
+        FloatPacket y_bound = current.y_mid + select(y_forward, current.half, -current.half);
+        if (grow > 0.0f) {
+            // Lands every ray in the open past the space around the quadrant, as `castParametric` does
+            t = max(t, min(exitX(x_bound + select(x_forward, grow, -grow)),
+                           exitY(y_bound + select(y_forward, grow, -grow))));
+            x = ox + t * dx;
+            y = oy + t * dy;
+        }
+        else {
+            FloatPacket t_x = exitX(x_bound);
+            FloatPacket t_y = exitY(y_bound);
+            t = max(t, min(t_x, t_y));
+
+            // Keeps the rays on the faces of the quadrant, as `castParametric` does
+            FloatPacket x_along = min(max(ox + t * dx, FloatPacket(current.x_mid - current.half)),
+                                      FloatPacket(current.x_mid + current.half));
+            FloatPacket y_along = min(max(oy + t * dy, FloatPacket(current.y_mid - current.half)),
+                                      FloatPacket(current.y_mid + current.half));
+            x = select(t_x <= t_y, x_bound, x_along);
+            y = select(t_y <= t_x, y_bound, y_along);
+        }
+
+        // Rays exiting the grid conclude without hitting anything, including those rounded onto a
+        // corner of the root just short of their exit
+        uint32_t exited = active & (mask(t_exit <= t) | ~contains(stack[0], x, y));
+        if (exited) {
+            FloatPacket last = min(t, t_exit);
+            (ox + last * dx).store(lanes_x);
+            (oy + last * dy).store(lanes_y);
+            for (int i = 0; i < WIDTH; i++) {
+                if (exited & (1u << i)) {
+                    out[i] = RayHit{.hit = false, .locus = SDL_FPoint{lanes_x[i], lanes_y[i]}};
+                }
+            }
+            active &= ~exited;
+        }
+        if (!active) {
+            break;
+        }
+
+        // Leaves the subgrids no longer containing the locus of the leading ray
+        lead = __builtin_ctz(active);
+        while (top >= 0 && !(contains(stack[top], x, y) & (1u << lead))) {
+            top--;
+        }
+    }
+}
+
+/*
+ * =====[Exact traversal]=====
+ *
+ *   x = 0b 1 0 1 1 0 ...     Quadrant at depth k: bit 29 - k of x and of y
+ *   y = 0b 0 1 1 0 1 ...     Common ancestor: leading zeros of (x ^ x') | (y ^ y')
+ *          ^ root
+ *
+ * Integer raycasting shared by every grid tree representation, using the same `Cursor` as
+ * `castSubgrid`. The root spans 2^30 units a side in fixed point, so that every boundary down to a
+ * depth of 30 lies on a whole unit. Quadrants are picked off the bits of the coordinates as a Morton
+ * code would interleave them, and subgrids left behind are popped up to the common ancestor at once.
+ *
+ * Which boundary the ray crosses first is decided by cross-multiplying 64-bit integers, without any
+ * rounding. The locus lands exactly on the crossed boundary, with the other coordinate recomputed from
+ * the point of entry rather than accumulated. Rays going towards X- or Y- look up the unit just below
+ * their locus, leaning them into the quadrant they head into.
+ *
+ * Trees known to be no deeper than `DEPTH` size their stack to it, and the descent through the levels
+ * is unrolled into straight code with the bit of each level fixed.
+ */
+template <typename Cursor, int DEPTH = 30>
+RayHit castExact(const Cursor& root, SDL_FPoint origin, SDL_FPoint direction) {
+    const int BITS = 30;
+    const int64_t SPAN = int64_t(1) << BITS;
+    static_assert(0 <= DEPTH && DEPTH <= BITS, "Levels finer than a unit can't be told apart");
+
+    // Clips against the root in floating point, as only the point of entry needs to be within it
+    float t_enter = 0.0f;
+    float t_exit = INF;
+    SDL_FPoint inverse = {1.0f / direction.x, 1.0f / direction.y};
+    if (!clipToGrid(origin, direction, inverse, t_enter, t_exit)) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+
+    auto toFixed = [&](float v) {
+        return std::clamp((int64_t)std::llround((v + 1.0) / 2.0 * SPAN), int64_t(0), SPAN);
+    };
+    auto toFloat = [&](int64_t v) {
+        return (float)((double)v / SPAN * 2.0 - 1.0);
+    };
+
+    int64_t x0 = toFixed(origin.x + t_enter * direction.x);
+    int64_t y0 = toFixed(origin.y + t_enter * direction.y);
+    int64_t dx = std::llround((double)direction.x * (int64_t(1) << 31));
+    int64_t dy = std::llround((double)direction.y * (int64_t(1) << 31));
+    int64_t x = x0;
+    int64_t y = y0;
+
+    Cursor stack[DEPTH + 1];
+    stack[0] = root;
+    int depth = 0;
+    int64_t last_x = -1;
+    int64_t last_y = -1;
+
+    while (true) {
+        // Looks up the unit the ray heads into, leaving once it is out of the root
+        int64_t look_x = x - (dx < 0);
+        int64_t look_y = y - (dy < 0);
+        if (look_x < 0 || look_x >= SPAN || look_y < 0 || look_y >= SPAN) {
+            break;
+        }
+
+        // Pops up to the deepest subgrid still containing the unit
+        if (last_x >= 0) {
+            uint64_t moved = (uint64_t)((look_x ^ last_x) | (look_y ^ last_y));
+            int common = std::countl_zero(moved) - (64 - BITS);
+            depth = std::min(depth, common);
+        }
+        last_x = look_x;
+        last_y = look_y;
+
+        // Descends along the bits of the unit, a level at a time, until reaching a leaf or an empty one
+        bool empty = false;
+        auto descend = [&]<int LEVEL>() {
+            if (LEVEL < depth) {
+                return true;
+            }
+            if (stack[LEVEL].isLeaf()) {
+                return false;
+            }
+
+            const int bit = BITS - 1 - LEVEL;
+            bool x_pos = (look_x >> bit) & 1;
+            bool y_pos = (look_y >> bit) & 1;
+            Cursor quadrant = stack[LEVEL];
+            COUNT_CAST_NODE();
+            if (!stack[LEVEL].quadrant(mapQuadrantIndex(x_pos, y_pos), quadrant)) {
+                COUNT_CAST_EMPTY(true);
+                empty = true;
+                return false;
+            }
+
+            stack[LEVEL + 1] = quadrant;
+            depth = LEVEL + 1;
+            COUNT_CAST_DEPTH(depth);
+            return true;
+        };
+        [&]<int... LEVELS>(std::integer_sequence<int, LEVELS...>) {
+            (descend.template operator()<LEVELS>() && ...);
+        }(std::make_integer_sequence<int, DEPTH>());
+
+        // Bounds of the leaf or the empty quadrant the unit lies in
+        int level = empty ? depth + 1 : depth;
+        int64_t size = SPAN >> level;
+        int64_t x_low = look_x & ~(size - 1);
+        int64_t y_low = look_y & ~(size - 1);
+
+        // Confirms ray hit success upon reaching a leaf, which trees deeper than `DEPTH` never do
+        if (!empty) {
+            if (!stack[depth].isLeaf()) {
+                break;
+            }
+
+            float local_x = (float)(2 * (x - x_low) - size) / size;
+            float local_y = (float)(2 * (y - y_low) - size) / size;
+            float half = (float)size / SPAN;
+            return RayHit{.hit = true,
+                          .locus = SDL_FPoint{toFloat(x), toFloat(y)},
+                          .color = shadeLeaf(stack[depth].color(), local_x, local_y),
+                          .face = leafFace(local_x, local_y),
+                          .leaf = SDL_FPoint{toFloat(x_low) + half, toFloat(y_low) + half}};
+        }
+
+        // Compares the distances to either boundary ahead, scaled by the other's direction
+        int64_t x_bound = dx > 0 ? x_low + size : x_low;
+        int64_t y_bound = dy > 0 ? y_low + size : y_low;
+        int64_t x_reach = dx != 0 ? std::abs(x_bound - x) * std::abs(dy) : INT64_MAX;
+        int64_t y_reach = dy != 0 ? std::abs(y_bound - y) * std::abs(dx) : INT64_MAX;
+
+        // Lands exactly on the crossed boundary, truncating the other coordinate towards the entry
+        if (x_reach <= y_reach) {
+            y = y_reach == x_reach ? y_bound : y0 + (x_bound - x0) * dy / dx;
+            x = x_bound;
+        }
+        else {
+            x = x0 + (y_bound - y0) * dx / dy;
+            y = y_bound;
+        }
+    }
+
+    // Exits the grid tree without hitting anything
+    return RayHit{.hit = false, .locus = SDL_FPoint{toFloat(x), toFloat(y)}};
+}
+
+/*
+ * Casts many rays from the same origin, in packets for the parametric engines and one by one otherwise.
+ * Rays stopping at a footprint part ways, hence are cast one by one as well, always through
+ * `castParametric`.
+ */
+template <typename Cursor>
+void castBatch(const Cursor& root, SDL_FPoint origin, std::span<const float> angles,
+               std::span<RayHit> out, CastEngine engine, float footprint = 0.0f) {
+    const int WIDTH = FloatPacket::WIDTH;
+    size_t count = std::min(angles.size(), out.size());
+    COUNT_CAST_RAYS(count);
+
+    size_t i = 0;
+    bool packets = engine == CastEngine::Parametric || engine == CastEngine::Roped;
+    if (packets && footprint <= 0.0f) {
+        for (; i + WIDTH <= count; i += WIDTH) {
+            SDL_FPoint directions[WIDTH];
+            for (int j = 0; j < WIDTH; j++) {
+                directions[j] = SDL_FPoint{std::sin(angles[i + j]), std::cos(angles[i + j])};
+            }
+
+            castPacket(root, origin, directions, &out[i]);
+        }
+    }
+
+    // Remaining rays which don't fill a whole packet, or aren't cast in packets at all
+    for (; i < count; i++) {
+        if (engine == CastEngine::Exact && footprint <= 0.0f) {
+            SDL_FPoint direction = {std::sin(angles[i]), std::cos(angles[i])};
+            out[i] = castExact(root, origin, direction);
+        }
+        else if (engine != CastEngine::Recursive || footprint > 0.0f) {
+            SDL_FPoint direction = {std::sin(angles[i]), std::cos(angles[i])};
+            out[i] = castParametric<Cursor>(root, origin, direction, INF, nullptr, footprint);
+        }
+        else {
+            out[i] = castSubgrid(root, origin, angles[i]);
+        }
+    }
+}
+
+// Casts from a point towards another, stopping as soon as it passes the target without hitting a leaf
+template <typename Cursor>
+RayHit castSegment(const Cursor& root, SDL_FPoint from, SDL_FPoint to,
+                   const CastOrigin<Cursor>* origin = nullptr) {
+    COUNT_CAST_RAYS(1);
+
+    // Reaches targets within the same empty quadrant straight away
+    if (origin && origin->open_low.x <= to.x && to.x <= origin->open_high.x &&
+        origin->open_low.y <= to.y && to.y <= origin->open_high.y) {
+        return RayHit{.hit = false, .locus = to};
+    }
+
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    float length = std::hypot(dx, dy);
+
+    // Segments of no length still hit the leaf they lie in, whichever way they face
+    SDL_FPoint direction =
+        length > 0.0f ? SDL_FPoint{dx / length, dy / length} : SDL_FPoint{0.0f, 1.0f};
+    return castParametric(root, from, direction, length, origin);
+}
@@ -6,6 +6,7 @@
 
 #include "grid_tree.hpp"
 
+class ThreadPool;
 
 const SDL_Color GRID_PALETTE[] = {
     {0, 0, 0, 0},         // 0 (none)
@@ -18,22 +19,56 @@ const SDL_Color GRID_PALETTE[] = {
     {255, 128, 255, 255}  // 7 (purple)
 };
 
+static inline uint8_t paletteIndex(const SDL_Color& color) {
+    // Anything transparent is considered as none
+    if (color.a == 0) {
+        return 0;
+    }
+
+    // Picks the nearest opaque palette color, which is exact for any treeified color
+    uint8_t nearest = 1;
+    int nearest_distance = INT32_MAX;
+    for (uint8_t i = 1; i < sizeof(GRID_PALETTE) / sizeof(GRID_PALETTE[0]); i++) {
+        int dr = (int)color.r - GRID_PALETTE[i].r;
+        int dg = (int)color.g - GRID_PALETTE[i].g;
+        int db = (int)color.b - GRID_PALETTE[i].b;
+
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < nearest_distance) {
+            nearest = i;
+            nearest_distance = distance;
+        }
+    }
+
+    return nearest;
+}
+
 class GridMap {
 private:
-    std::vector<std::vector<uint8_t>> map;
+    // Blocks in row-major order, packing two per byte with the even column in the low nibble. Rows are
+    // `stride` bytes apart and padded with empty blocks.
+    std::vector<uint8_t> cells;
+    size_t stride = 0;
 
 public:
     size_t width = 0;
     size_t height = 0;
 
     GridMap() {}
+    GridMap(size_t width, size_t height);
     GridMap(const std::string& file_name);
 
+    bool save(const std::string& file_name) const;
+
     uint8_t getAt(size_t x, size_t y) const;
     void setAt(size_t x, size_t y, uint8_t type);
 
     GridTree treeify() const;
+    GridTree treeify(ThreadPool& pool) const;
+    GridTree treeify(size_t x_start, size_t y_start, size_t size) const;
 
 private:
-    void subtreeify(GridTree& tree, size_t x_start, size_t y_start, size_t size) const;
+    GridTree subtreeify(size_t x_start, size_t y_start, size_t size) const;
+    GridTree assemble(std::vector<GridTree>& subtrees, size_t split, size_t subtree_size,
+                      size_t x_start, size_t y_start, size_t size) const;
 };
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+
+#include <SDL3/SDL.h>
+
+#include "grid_cast.hpp"
+#include "grid_tree.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+
+/*
+ * Spatial queries shared by every grid tree representation, walking the same `Cursor` as the casts.
+ *
+ * Nodes are tested against the queried shape before being descended into, so that whole quadrants out
+ * of reach are rejected at once and absent quadrants, being empty, are never visited. Nothing is
+ * allocated, so that queries may run concurrently from any thread. Shapes merely touching a leaf don't
+ * overlap it.
+ */
+template <typename Cursor>
+bool querySolidAt(const Cursor& root, SDL_FPoint point) {
+    if (point.x < -1.0f || 1.0f < point.x || point.y < -1.0f || 1.0f < point.y) {
+        return false;
+    }
+
+    Cursor node = root;
+    float x_mid = 0.0f;
+    float y_mid = 0.0f;
+    float half = 1.0f;
+    while (!node.isLeaf()) {
+        bool x_pos = point.x >= x_mid;
+        bool y_pos = point.y >= y_mid;
+        if (!node.quadrant(mapQuadrantIndex(x_pos, y_pos), node)) {
+            return false;
+        }
+
+        half /= 2.0f;
+        x_mid += x_pos ? half : -half;
+        y_mid += y_pos ? half : -half;
+    }
+
+    return node.color().a != 0;
+}
+
+// Whether any solid leaf overlaps a shape, given as a test of whether it overlaps a node's bounds
+template <typename Cursor, typename Overlaps>
+bool queryOverlap(const Cursor& node, float x_mid, float y_mid, float half, const Overlaps& overlaps) {
+    if (!overlaps(x_mid - half, y_mid - half, x_mid + half, y_mid + half)) {
+        return false;
+    }
+
+    if (node.isLeaf()) {
+        return node.color().a != 0;
+    }
+
+    float quarter = half / 2.0f;
+    for (int i = 0b00; i <= 0b11; i++) {
+        bool x_pos = i & 0b01;
+        bool y_pos = i & 0b10;
+        Cursor quadrant = node;
+        if (node.quadrant(mapQuadrantIndex(x_pos, y_pos), quadrant) &&
+            queryOverlap(quadrant, x_mid + (x_pos ? quarter : -quarter),
+                         y_mid + (y_pos ? quarter : -quarter), quarter, overlaps)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename Cursor>
+bool queryOverlapsBox(const Cursor& root, QueryBox box) {
+    auto overlaps = [&](float x_low, float y_low, float x_high, float y_high) {
+        return box.low.x < x_high && x_low < box.high.x && box.low.y < y_high && y_low < box.high.y;
+    };
+    return queryOverlap(root, 0.0f, 0.0f, 1.0f, overlaps);
+}
+
+template <typename Cursor>
+bool queryOverlapsCircle(const Cursor& root, SDL_FPoint center, float radius) {
+    auto overlaps = [&](float x_low, float y_low, float x_high, float y_high) {
+        float dx = center.x - std::clamp(center.x, x_low, x_high);
+        float dy = center.y - std::clamp(center.y, y_low, y_high);
+        return dx * dx + dy * dy < radius * radius;
+    };
+    return queryOverlap(root, 0.0f, 0.0f, 1.0f, overlaps);
+}
+
+// Triangles only overlap nodes past every one of their edges, degenerate ones overlapping nothing
+template <typename Cursor>
+bool queryOverlapsTriangle(const Cursor& root, SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) {
+    // Normal of every edge pointing inwards, along with where the edge lies along it
+    const SDL_FPoint corners[3] = {a, b, c};
+    SDL_FPoint normals[3];
+    float offsets[3];
+    for (int i = 0; i < 3; i++) {
+        SDL_FPoint from = corners[i];
+        SDL_FPoint to = corners[(i + 1) % 3];
+        SDL_FPoint opposite = corners[(i + 2) % 3];
+        SDL_FPoint normal = {from.y - to.y, to.x - from.x};
+        float side = (opposite.x - from.x) * normal.x + (opposite.y - from.y) * normal.y;
+        if (side == 0.0f) {
+            return false;
+        }
+        if (side < 0.0f) {
+            normal = {-normal.x, -normal.y};
+        }
+
+        normals[i] = normal;
+        offsets[i] = from.x * normal.x + from.y * normal.y;
+    }
+
+    QueryBox bounds = {{std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y})},
+                       {std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y})}};
+    auto overlaps = [&](float x_low, float y_low, float x_high, float y_high) {
+        if (!(bounds.low.x < x_high && x_low < bounds.high.x && bounds.low.y < y_high &&
+              y_low < bounds.high.y)) {
+            return false;
+        }
+
+        // Separated by any edge leaving even the node's innermost corner outside
+        for (int i = 0; i < 3; i++) {
+            float x = normals[i].x > 0.0f ? x_high : x_low;
+            float y = normals[i].y > 0.0f ? y_high : y_low;
+            if (x * normals[i].x + y * normals[i].y <= offsets[i]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return queryOverlap(root, 0.0f, 0.0f, 1.0f, overlaps);
+}
+
+// Narrows down the nearest solid leaf, skipping nodes no nearer than the best one found so far
+template <typename Cursor>
+void queryNearest(const Cursor& node, float x_mid, float y_mid, float half, SDL_FPoint point,
+                  SolidHit& best) {
+    if (node.isLeaf()) {
+        if (node.color().a == 0) {
+            return;
+        }
+
+        SDL_FPoint nearest = {std::clamp(point.x, x_mid - half, x_mid + half),
+                              std::clamp(point.y, y_mid - half, y_mid + half)};
+        float distance = std::hypot(point.x - nearest.x, point.y - nearest.y);
+        if (distance <= best.distance && (!best.found || distance < best.distance)) {
+            best = SolidHit{true, nearest, distance};
+        }
+        return;
+    }
+
+    // Visits the quadrants nearest first, so that the farther ones are more likely to be skipped
+    struct Quadrant {
+        Cursor tree;
+        float x_mid, y_mid, distance;
+    } quadrants[4];
+    int count = 0;
+
+    float quarter = half / 2.0f;
+    for (int i = 0b00; i <= 0b11; i++) {
+        bool x_pos = i & 0b01;
+        bool y_pos = i & 0b10;
+        Quadrant quadrant = {node, x_mid + (x_pos ? quarter : -quarter),
+                             y_mid + (y_pos ? quarter : -quarter)};
+        if (!node.quadrant(mapQuadrantIndex(x_pos, y_pos), quadrant.tree)) {
+            continue;
+        }
+
+        float dx = point.x - std::clamp(point.x, quadrant.x_mid - quarter, quadrant.x_mid + quarter);
+        float dy = point.y - std::clamp(point.y, quadrant.y_mid - quarter, quadrant.y_mid + quarter);
+        quadrant.distance = std::hypot(dx, dy);
+        if (quadrant.distance > best.distance) {
+            continue;
+        }
+
+        int j = count++;
+        for (; j > 0 && quadrants[j - 1].distance > quadrant.distance; j--) {
+            quadrants[j] = quadrants[j - 1];
+        }
+        quadrants[j] = quadrant;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (quadrants[i].distance <= best.distance) {
+            const Quadrant& quadrant = quadrants[i];
+            queryNearest(quadrant.tree, quadrant.x_mid, quadrant.y_mid, quarter, point, best);
+        }
+    }
+}
+
+template <typename Cursor>
+SolidHit queryNearestSolid(const Cursor& root, SDL_FPoint point, float radius) {
+    SolidHit best = {.distance = radius};
+    queryNearest(root, 0.0f, 0.0f, 1.0f, point, best);
+    if (!best.found) {
+        best.distance = INF;
+    }
+    return best;
+}
+
+// Adds a node and every one below it to the counts of their depths
+template <typename Cursor>
+void queryTreeStats(const Cursor& node, size_t depth, TreeStats& stats) {
+    if (stats.depths.size() <= depth) {
+        stats.depths.resize(depth + 1);
+    }
+    stats.nodes++;
+    stats.depths[depth]++;
+
+    if (node.isLeaf()) {
+        stats.leaves += node.color().a != 0;
+        return;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        Cursor quadrant = node;
+        if (node.quadrant(i, quadrant)) {
+            queryTreeStats(quadrant, depth + 1, stats);
+        }
+    }
+}
+
+// Runs a query per input, in chunks across the pool when given one
+template <typename Input, typename Output, typename Query>
+void queryBatch(std::span<const Input> in, std::span<Output> out, ThreadPool* pool,
+                const Query& query) {
+    size_t count = std::min(in.size(), out.size());
+    auto run = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            out[i] = query(in[i]);
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(count, 256, run);
+    }
+    else {
+        run(0, count);
+    }
+}
+
+// Sight along every pair, locating the origin once for consecutive pairs sharing it
+template <typename Cursor>
+void queryLineOfSight(const Cursor& root, std::span<const SightPair> pairs, std::span<uint8_t> out,
+                      ThreadPool* pool) {
+    size_t count = std::min(pairs.size(), out.size());
+    auto run = [&](size_t begin, size_t end) {
+        CastOrigin<Cursor> origin;
+        for (size_t i = begin; i < end; i++) {
+            const SightPair& pair = pairs[i];
+            if (i == begin || pair.from.x != origin.point.x || pair.from.y != origin.point.y) {
+                locateOrigin(root, pair.from, origin);
+            }
+            out[i] = !castSegment(root, pair.from, pair.to, &origin).hit;
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(count, 256, run);
+    }
+    else {
+        run(0, count);
+    }
+}
+
+/*
+ * Sight from every viewer to every target, written row by row with a row per viewer. Each viewer is
+ * located once for its whole row. Viewers being their own targets see each other mutually, so that
+ * only the pairs above the diagonal are cast, each one mirrored below it. Only as many rows as fit
+ * into `out` are written, mirrored pairs included.
+ */
+template <typename Cursor>
+void queryLineOfSight(const Cursor& root, std::span<const SDL_FPoint> viewers,
+                      std::span<const SDL_FPoint> targets, std::span<uint8_t> out, ThreadPool* pool) {
+    size_t columns = targets.size();
+    if (columns == 0) {
+        return;
+    }
+
+    size_t rows = std::min(viewers.size(), out.size() / columns);
+    bool mutual = viewers.data() == targets.data() && viewers.size() == columns;
+    auto run = [&](size_t begin, size_t end) {
+        CastOrigin<Cursor> origin;
+        for (size_t i = begin; i < end; i++) {
+            locateOrigin(root, viewers[i], origin);
+            for (size_t j = mutual ? i : 0; j < columns; j++) {
+                uint8_t seen = !castSegment(root, viewers[i], targets[j], &origin).hit;
+                out[i * columns + j] = seen;
+                if (mutual && j < rows) {
+                    out[j * columns + i] = seen;
+                }
+            }
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(rows, 1, run);
+    }
+    else {
+        run(0, rows);
+    }
+}
@@ -1,16 +1,70 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <SDL3/SDL.h>
 
 
+// Side of the leaf a ray hits, being where the ray came from
+enum class HitFace : uint8_t { None, XPos, XNeg, YPos, YNeg };
+
 struct RayHit {
     bool hit;
     SDL_FPoint locus;
     SDL_Color color = {0, 0, 0, 0};
+    HitFace face = HitFace::None;
+    SDL_FPoint leaf = {0.0f, 0.0f}; // Center of the leaf hit, telling leaves apart
+
+    // Whether the ray stopped short, at a part of the world which isn't loaded yet
+    bool missed = false;
+};
+
+// Axis-aligned box in the root's coordinates
+struct QueryBox {
+    SDL_FPoint low, high;
+};
+
+// Nearest point of a solid leaf to the one queried
+struct SolidHit {
+    bool found = false;
+    SDL_FPoint point = {0.0f, 0.0f};
+    float distance = std::numeric_limits<float>::infinity();
+};
+
+// Segment along which to check sight, from a viewer to a target
+struct SightPair {
+    SDL_FPoint from, to;
+};
+
+// Shape of a grid tree, counting only the nodes present
+struct TreeStats {
+    size_t nodes = 0;           // Every node, leaves included
+    size_t leaves = 0;          // Solid leaves
+    size_t bytes = 0;           // Memory held by the nodes, along with anything linking them
+    std::vector<size_t> depths; // Nodes per depth, the root's being zero
+};
+
+enum class CastEngine {
+    Recursive,  // Recurses per level, remapping coordinates into each subgrid
+    Parametric, // Iterates with an explicit stack, stepping through slabs in the root's coordinates
+    Roped,      // Walks from leaf to leaf along the ropes of a flat grid tree, else as `Parametric`
+    Exact,      // Walks integer unit coordinates, picking quadrants off their bits without rounding
 };
 
+// Side in the root's coordinates that `pixels` columns of a view span per unit of distance, for casts
+// to stop refining nodes narrower than that
+inline float pixelFootprint(float fov, int columns, float pixels) {
+    return 2.0f * std::tan(fov / 2.0f) / columns * pixels;
+}
+
+class BeamTracer;
+class ThreadPool;
+
 class GridTree {
 private:
     /*
@@ -26,7 +80,18 @@ private:
      */
     GridTree* quadrants[4] = {nullptr, nullptr, nullptr, nullptr};
 
+    // Of every empty quadrant, how far it grows on every side without reaching a block, in 256ths of
+    // its side, filling the padding after `color`. Zero unless measured, skipping nothing then.
+    uint8_t gaps[4] = {0, 0, 0, 0};
+
+    // Node handle for `castSubgrid`
+    struct Cursor;
+
+    friend class FlatGridTree;
+
 public:
+    // Of the blocks at a leaf, whereas branches keep the average color of their solid blocks along with
+    // the fraction of the subgrid they cover as alpha, weighing it within the branches above
     SDL_Color color;
 
     GridTree(SDL_Color color = {0, 0, 0, 0}) : color(color) {}
@@ -37,15 +102,84 @@ public:
     ~GridTree();
 
     void setQuadrant(bool xPos, bool yPos, const GridTree& tree);
+    void setQuadrant(bool xPos, bool yPos, GridTree&& tree);
     void clearQuadrant(bool xPos, bool yPos);
     bool hasQuadrant(bool xPos, bool yPos) const;
     GridTree& getQuadrant(bool xPos, bool yPos);
     bool isLeaf() const;
+    size_t count() const;
 
     void prune();
-    RayHit cast(SDL_FPoint origin, float angle) const;
+
+    // Sums up the quadrants into the color of a branch, as every edit through the tree does
+    void represent();
+
+    /*
+     * Writes blocks of a map whose grid spans `size` blocks of a side, with (0, 0) at its X- Y+ corner
+     * as in `GridMap`. Only the nodes along the edited blocks are split and merged back, and the root
+     * is grown by doubling whenever the blocks exceed it, returning the new size. The clearance of the
+     * empty quadrants within reach of the blocks is measured again if it was before, or if asked to.
+     */
+    size_t setCell(size_t size, size_t x, size_t y, SDL_Color color, bool clearance = false);
+    size_t setRect(size_t size, size_t x, size_t y, size_t width, size_t height, SDL_Color color,
+                   bool clearance = false);
+
+    /*
+     * Measures how far every empty quadrant grows without reaching a block, for the parametric casts to
+     * skip across the open space around it at once. Nothing is skipped until it has been measured.
+     */
+    void measureClearance();
+
+    /*
+     * Given a footprint, as from `pixelFootprint`, rays go through the parametric engine whatever the
+     * one asked for, stopping at branches projecting onto less than it to hit them by their color.
+     */
+    RayHit cast(SDL_FPoint origin, float angle, CastEngine engine = CastEngine::Recursive,
+                float footprint = 0.0f) const;
+    void castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                   CastEngine engine = CastEngine::Parametric, float footprint = 0.0f) const;
+
+    // Traces the view frustum front to back, leaving the faces seen across `columns` in `tracer.spans`
+    void traceBeam(SDL_FPoint origin, float angle, float fov, int columns, BeamTracer& tracer) const;
+
+    /*
+     * Spatial queries in the root's coordinates, rejecting empty quadrants without visiting them. The
+     * nearest solid point is only looked for within the radius. Batches write a result per input, split
+     * across the pool when given one.
+     */
+    bool solidAt(SDL_FPoint point) const;
+    bool overlapsBox(QueryBox box) const;
+    bool overlapsCircle(SDL_FPoint center, float radius) const;
+    bool overlapsTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) const;
+    SolidHit nearestSolid(SDL_FPoint point, float radius) const;
+    void solidAtBatch(std::span<const SDL_FPoint> points, std::span<uint8_t> out,
+                      ThreadPool* pool = nullptr) const;
+    void overlapsBoxBatch(std::span<const QueryBox> boxes, std::span<uint8_t> out,
+                          ThreadPool* pool = nullptr) const;
+    void overlapsCircleBatch(std::span<const SDL_FPoint> centers, float radius, std::span<uint8_t> out,
+                             ThreadPool* pool = nullptr) const;
+    void nearestSolidBatch(std::span<const SDL_FPoint> points, float radius, std::span<SolidHit> out,
+                           ThreadPool* pool = nullptr) const;
+
+    /*
+     * Casts only between two points, hitting nothing beyond the target. Sight is checked in bulk either
+     * along pairs or from every viewer to every target into a row per viewer, locating each origin once
+     * for the casts sharing it and splitting the work across the pool when given one.
+     */
+    RayHit castSegment(SDL_FPoint from, SDL_FPoint to) const;
+    bool lineOfSight(SDL_FPoint from, SDL_FPoint to) const;
+    void lineOfSight(std::span<const SightPair> pairs, std::span<uint8_t> out,
+                     ThreadPool* pool = nullptr) const;
+    void lineOfSight(std::span<const SDL_FPoint> viewers, std::span<const SDL_FPoint> targets,
+                     std::span<uint8_t> out, ThreadPool* pool = nullptr) const;
+
+    TreeStats stats() const;
     std::string graphviz() const;
 
 private:
+    void setSubgrid(size_t x_start, size_t y_start, size_t size, size_t x, size_t y, size_t width,
+                    size_t height, SDL_Color color);
+    void measureGaps(const GridTree& root, float x_mid, float y_mid, float half, QueryBox near,
+                     bool all);
     std::string graphviz(int& i) const;
 };
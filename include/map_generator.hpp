@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "grid_map.hpp"
+
+
+/*
+ * Synthetic maps for benchmarking, deterministic for a given size, density and seed.
+ *
+ * - noise: blocks of random colors scattered with the given density
+ * - maze: a perfect maze whose corridors are a single block wide, with the density of loops punched in
+ * - caves: noise smoothed by cellular automata into caverns, walled in more with higher densities
+ * - rooms: a mostly open world of hollow rooms with doorways, covering roughly the given density
+ */
+enum class MapKind { Noise, Maze, Caves, Rooms };
+
+bool parseMapKind(const std::string& name, MapKind& kind);
+const char* mapKindName(MapKind kind);
+
+GridMap generateMap(MapKind kind, size_t size, float density, uint32_t seed);
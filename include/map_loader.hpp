@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "grid_map.hpp"
+#include "grid_tree.hpp"
+#include "thread_pool.hpp"
+
+
+// Text map along with everything built from it, handed over to the renderer as a whole
+struct LoadedMap {
+    std::string file_name;
+    GridMap map;
+    GridTree tree;
+    size_t size = 1; // Blocks spanned by a side of the tree
+    TreeStats stats;
+};
+
+/*
+ * =====[Map loader]=====
+ *
+ *   load(file) ---> [loader thread] parse, treeify ---> ready ---> take() at a frame boundary
+ *   file changed -------^                                              |
+ *                       ^---------- graveyard <--- retire(old map) ----+
+ *
+ * Loads text maps and builds their trees on a thread of its own, so that the renderer never waits on
+ * them. The latest map built is published through an atomic pointer, which the renderer exchanges for
+ * null once between frames, a newer map replacing one not taken yet. Maps the renderer let go of are
+ * handed back, once no frame casts through them anymore, and torn down on the loader thread as well,
+ * freeing large trees taking about as long as building them.
+ *
+ * The first map, which the view stays empty until, is built across a pool of its own, let go of right
+ * after. Maps loaded again are built on the loader thread alone, leaving the cores to the frames.
+ *
+ * When watching, the file last asked for is loaded again whenever it is written to, the loader thread
+ * sleeping on inotify on Linux and polling its modification time elsewhere. Builds without threads
+ * load right away.
+ */
+class MapLoader {
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::string requested;                             // File to load next, if any
+    std::vector<std::unique_ptr<LoadedMap>> graveyard; // Maps to tear down
+    std::atomic<LoadedMap*> ready = nullptr;           // Latest map built, until taken
+    std::atomic<bool> busy = false;
+    std::unique_ptr<ThreadPool> pool; // Workers building the first map, until it is built
+
+    // File watched for changes, along with how
+    std::filesystem::path watched;
+    std::filesystem::file_time_type modified;
+    int notify_fd = -1;
+    int watch_fd = -1;
+    int wake_fd = -1; // Interrupts sleeping on inotify, as the condition variable can't
+
+public:
+    bool watch = false;     // Whether to load the file again upon changes
+    bool clearance = false; // Whether to measure the clearance of the tree once built
+
+    MapLoader(size_t workers = ThreadPool::defaultWorkers());
+    MapLoader(const MapLoader&) = delete;
+    MapLoader& operator=(const MapLoader&) = delete;
+
+    ~MapLoader();
+
+    // Asks for the map to be loaded, superseding any file asked for before
+    void load(const std::string& file_name);
+
+    // Latest map built since the last call, if any, without ever blocking
+    std::unique_ptr<LoadedMap> take();
+
+    // Hands a map over to be torn down off the calling thread
+    void retire(std::unique_ptr<LoadedMap> map);
+
+    // Whether a map is being loaded or waiting to be
+    bool loading() const;
+
+private:
+    void run();
+    void notify();
+    void build(const std::string& file_name);
+    void watchFile(const std::string& file_name);
+    bool waitForChange(std::unique_lock<std::mutex>& lock);
+    bool fileChanged();
+};
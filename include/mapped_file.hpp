@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*
+ * Read-only view of a whole file, memory-mapped where the platform allows so that its pages are only
+ * brought in as they are touched, and read into memory otherwise.
+ */
+class MappedFile {
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+
+    // Contents of the file on platforms without memory mapping
+    std::vector<uint8_t> buffer;
+
+public:
+    MappedFile(const std::string& file_name);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const uint8_t* data() const;
+    size_t size() const;
+};
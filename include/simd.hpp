@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * Minimal packet of floats, mapped to AVX (8 lanes) or SSE (4 lanes) when available and to plain
+ * arrays otherwise. Comparisons yield packets whose lanes are either all ones or all zeros, usable as
+ * masks for `select` and `mask`.
+ */
+#if defined(__AVX__)
+struct FloatPacket {
+    static const int WIDTH = 8;
+    __m256 v;
+
+    FloatPacket() : v(_mm256_setzero_ps()) {}
+    FloatPacket(__m256 v) : v(v) {}
+    FloatPacket(float x) : v(_mm256_set1_ps(x)) {}
+
+    static FloatPacket load(const float* p) {
+        return _mm256_loadu_ps(p);
+    }
+
+    void store(float* p) const {
+        _mm256_storeu_ps(p, this->v);
+    }
+
+    friend FloatPacket operator+(FloatPacket a, FloatPacket b) {
+        return _mm256_add_ps(a.v, b.v);
+    }
+    friend FloatPacket operator-(FloatPacket a, FloatPacket b) {
+        return _mm256_sub_ps(a.v, b.v);
+    }
+    friend FloatPacket operator*(FloatPacket a, FloatPacket b) {
+        return _mm256_mul_ps(a.v, b.v);
+    }
+    friend FloatPacket operator&(FloatPacket a, FloatPacket b) {
+        return _mm256_and_ps(a.v, b.v);
+    }
+    friend FloatPacket operator|(FloatPacket a, FloatPacket b) {
+        return _mm256_or_ps(a.v, b.v);
+    }
+    friend FloatPacket operator<(FloatPacket a, FloatPacket b) {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+    }
+    friend FloatPacket operator<=(FloatPacket a, FloatPacket b) {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+    }
+    friend FloatPacket operator==(FloatPacket a, FloatPacket b) {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ);
+    }
+
+    friend FloatPacket min(FloatPacket a, FloatPacket b) {
+        return _mm256_min_ps(a.v, b.v);
+    }
+    friend FloatPacket max(FloatPacket a, FloatPacket b) {
+        return _mm256_max_ps(a.v, b.v);
+    }
+    friend FloatPacket select(FloatPacket mask, FloatPacket a, FloatPacket b) {
+        return _mm256_blendv_ps(b.v, a.v, mask.v);
+    }
+    friend uint32_t mask(FloatPacket a) {
+        return _mm256_movemask_ps(a.v);
+    }
+};
+#elif defined(__SSE2__)
+struct FloatPacket {
+    static const int WIDTH = 4;
+    __m128 v;
+
+    FloatPacket() : v(_mm_setzero_ps()) {}
+    FloatPacket(__m128 v) : v(v) {}
+    FloatPacket(float x) : v(_mm_set1_ps(x)) {}
+
+    static FloatPacket load(const float* p) {
+        return _mm_loadu_ps(p);
+    }
+
+    void store(float* p) const {
+        _mm_storeu_ps(p, this->v);
+    }
+
+    friend FloatPacket operator+(FloatPacket a, FloatPacket b) {
+        return _mm_add_ps(a.v, b.v);
+    }
+    friend FloatPacket operator-(FloatPacket a, FloatPacket b) {
+        return _mm_sub_ps(a.v, b.v);
+    }
+    friend FloatPacket operator*(FloatPacket a, FloatPacket b) {
+        return _mm_mul_ps(a.v, b.v);
+    }
+    friend FloatPacket operator&(FloatPacket a, FloatPacket b) {
+        return _mm_and_ps(a.v, b.v);
+    }
+    friend FloatPacket operator|(FloatPacket a, FloatPacket b) {
+        return _mm_or_ps(a.v, b.v);
+    }
+    friend FloatPacket operator<(FloatPacket a, FloatPacket b) {
+        return _mm_cmplt_ps(a.v, b.v);
+    }
+    friend FloatPacket operator<=(FloatPacket a, FloatPacket b) {
+        return _mm_cmple_ps(a.v, b.v);
+    }
+    friend FloatPacket operator==(FloatPacket a, FloatPacket b) {
+        return _mm_cmpeq_ps(a.v, b.v);
+    }
+
+    friend FloatPacket min(FloatPacket a, FloatPacket b) {
+        return _mm_min_ps(a.v, b.v);
+    }
+    friend FloatPacket max(FloatPacket a, FloatPacket b) {
+        return _mm_max_ps(a.v, b.v);
+    }
+    friend FloatPacket select(FloatPacket mask, FloatPacket a, FloatPacket b) {
+        // SSE2 lacks a blend instruction
+        return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+    }
+    friend uint32_t mask(FloatPacket a) {
+        return _mm_movemask_ps(a.v);
+    }
+};
+#else
+struct FloatPacket {
+    static const int WIDTH = 4;
+    float v[WIDTH];
+
+    FloatPacket() : FloatPacket(0.0f) {}
+    FloatPacket(float x) {
+        for (int i = 0; i < WIDTH; i++) {
+            this->v[i] = x;
+        }
+    }
+
+    static FloatPacket load(const float* p) {
+        FloatPacket a;
+        for (int i = 0; i < WIDTH; i++) {
+            a.v[i] = p[i];
+        }
+        return a;
+    }
+
+    void store(float* p) const {
+        for (int i = 0; i < WIDTH; i++) {
+            p[i] = this->v[i];
+        }
+    }
+
+#define FLOAT_PACKET_OPERATOR(NAME, EXPR)                   \
+    friend FloatPacket NAME(FloatPacket a, FloatPacket b) { \
+        FloatPacket c;                                      \
+        for (int i = 0; i < WIDTH; i++) {                   \
+            float x = a.v[i], y = b.v[i];                   \
+            c.v[i] = (EXPR);                                \
+        }                                                   \
+        return c;                                           \
+    }
+
+    // Masks are represented as -1 for set lanes, and 0 for cleared ones
+    FLOAT_PACKET_OPERATOR(operator+, x + y)
+    FLOAT_PACKET_OPERATOR(operator-, x - y)
+    FLOAT_PACKET_OPERATOR(operator*, x * y)
+    FLOAT_PACKET_OPERATOR(operator&, x != 0.0f && y != 0.0f ? -1.0f : 0.0f)
+    FLOAT_PACKET_OPERATOR(operator|, x != 0.0f || y != 0.0f ? -1.0f : 0.0f)
+    FLOAT_PACKET_OPERATOR(operator<, x < y ? -1.0f : 0.0f)
+    FLOAT_PACKET_OPERATOR(operator<=, x <= y ? -1.0f : 0.0f)
+    FLOAT_PACKET_OPERATOR(operator==, x == y ? -1.0f : 0.0f)
+    FLOAT_PACKET_OPERATOR(min, x < y ? x : y)
+    FLOAT_PACKET_OPERATOR(max, x > y ? x : y)
+
+#undef FLOAT_PACKET_OPERATOR
+
+    friend FloatPacket select(FloatPacket mask, FloatPacket a, FloatPacket b) {
+        FloatPacket c;
+        for (int i = 0; i < WIDTH; i++) {
+            c.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+        }
+        return c;
+    }
+    friend uint32_t mask(FloatPacket a) {
+        uint32_t bits = 0;
+        for (int i = 0; i < WIDTH; i++) {
+            bits |= (a.v[i] != 0.0f) << i;
+        }
+        return bits;
+    }
+};
+#endif
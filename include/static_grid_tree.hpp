@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+
+#include <SDL3/SDL.h>
+
+#include "beam_tracer.hpp"
+#include "flat_grid_tree.hpp"
+#include "grid_cast.hpp"
+#include "grid_map.hpp"
+#include "grid_query.hpp"
+#include "grid_tree.hpp"
+#include "utils.hpp"
+
+
+/*
+ * =====[Static grid tree]=====
+ *
+ *   maps/a.txt --(quadcaster-convert --header)--> a.hpp: constexpr FlatGridNode A_NODES[] = {...};
+ *                                                        constexpr StaticGridTree<DEPTH> A = {...};
+ *
+ * Read-only grid tree over a constant table of nodes laid out as in `FlatGridTree`, which is compiled
+ * into the program along with it. Nothing is parsed, built nor allocated upon startup, as the table
+ * sits in read-only data from the start.
+ *
+ * The depth of the tree is known at compile time, for rays to be cast with the exact engine specialized
+ * on it: its stack is sized to the tree, and the descent is unrolled with the bit of every level fixed.
+ */
+template <int DEPTH>
+class StaticGridTree {
+private:
+    const FlatGridNode* nodes;
+    size_t count;
+
+    // Node handle for the shared traversals, as on `FlatGridTree`
+    struct Cursor {
+        const FlatGridNode* nodes = nullptr;
+        FlatGridNode node = FLAT_LEAF;
+
+        bool isLeaf() const {
+            return this->node & FLAT_LEAF;
+        }
+
+        SDL_Color color() const {
+            return GRID_PALETTE[this->node & ~FLAT_LEAF];
+        }
+
+        bool quadrant(size_t index, Cursor& out) const {
+            out.nodes = this->nodes;
+            out.node = this->nodes[this->node + index];
+            return out.node != FLAT_LEAF;
+        }
+
+        float clearance(size_t) const {
+            return 0.0f;
+        }
+    };
+
+    Cursor root() const {
+        return Cursor{this->nodes, this->nodes[0]};
+    }
+
+public:
+    // Dimensions of the source map in blocks
+    size_t width = 0;
+    size_t height = 0;
+
+    constexpr StaticGridTree(std::span<const FlatGridNode> nodes, size_t width, size_t height)
+        : nodes(nodes.data()), count(nodes.size()), width(width), height(height) {}
+
+    size_t size() const {
+        return this->count;
+    }
+
+    size_t bytes() const {
+        return this->count * sizeof(FlatGridNode);
+    }
+
+    RayHit cast(SDL_FPoint origin, float angle) const {
+        COUNT_CAST_RAYS(1);
+        SDL_FPoint direction = {std::sin(angle), std::cos(angle)};
+        return castExact<Cursor, DEPTH>(this->root(), origin, direction);
+    }
+
+    void castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out) const {
+        size_t count = std::min(angles.size(), out.size());
+        COUNT_CAST_RAYS(count);
+        for (size_t i = 0; i < count; i++) {
+            SDL_FPoint direction = {std::sin(angles[i]), std::cos(angles[i])};
+            out[i] = castExact<Cursor, DEPTH>(this->root(), origin, direction);
+        }
+    }
+
+    void traceBeam(SDL_FPoint origin, float angle, float fov, int columns, BeamTracer& tracer) const {
+        ::traceBeam(this->root(), origin, angle, fov, columns, tracer);
+    }
+
+    bool overlapsCircle(SDL_FPoint center, float radius) const {
+        return queryOverlapsCircle(this->root(), center, radius);
+    }
+
+    bool overlapsTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) const {
+        return queryOverlapsTriangle(this->root(), a, b, c);
+    }
+
+    TreeStats stats() const {
+        TreeStats stats = FlatGridTree::stats(std::span(this->nodes, this->count));
+        stats.bytes = this->bytes();
+        return stats;
+    }
+};
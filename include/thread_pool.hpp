@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+/*
+ * Persistent pool of worker threads running work-stealing parallel loops.
+ *
+ * Each loop is split into chunks dealt out to per-thread queues. Threads pop chunks off the front of
+ * their own queue, and steal off the back of the others' once theirs runs dry. The calling thread
+ * takes part as well, so a pool of zero workers simply runs everything inline.
+ */
+class ThreadPool {
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::pair<size_t, size_t>> chunks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues; // One per worker, plus the caller's at the end
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    size_t generation = 0;
+    bool stopping = false;
+
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    std::atomic<size_t> pending = 0;
+
+public:
+    ThreadPool(size_t workers = defaultWorkers());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    static size_t defaultWorkers();
+    size_t size() const;
+
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    void run(size_t index);
+    bool take(size_t index, std::pair<size_t, size_t>& chunk);
+    void work(size_t index);
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_grid_tree.hpp"
+#include "grid_tree.hpp"
+
+
+/*
+ * =====[World manifest]=====
+ *
+ *   quadcaster-world 1
+ *   tile_size 256
+ *   tiles 16 12
+ *   tile 0 0 world-tiles/0_0.qct
+ *   tile 3 0 world-tiles/3_0.qct
+ *   ...
+ *
+ * A text file laying out `tiles` columns and rows of square tiles, each `tile_size` blocks (a power
+ * of two) of a side. Every tile is a grid tree file, relative to the manifest. Tiles without any
+ * blocks are left out. As with a single map, the world spans [-1, 1] along its longer side, with the
+ * tile at column and row zero at its X- Y+ corner.
+ *
+ * The manifest stands as the top level of the world's tree flattened into a uniform grid, rather than
+ * as a tree of directories: tiles are found by their column and row at once, and rays walk across
+ * them by DDA, stepping over the tiles left out without touching the cache.
+ */
+enum class TileMiss {
+    Load,   // Pages the tile in on the spot, stalling the ray meanwhile
+    Report, // Stops the ray short as missed, queueing the tile up for `pageRequested`
+};
+
+class TiledWorld {
+private:
+    struct Tile {
+        std::string file_name; // None if the tile is empty
+        std::shared_ptr<const FlatGridTree> tree;
+        std::list<size_t>::iterator recent;
+        bool requested = false;
+        bool broken = false; // Failed to load, hence appearing empty
+    };
+
+    std::vector<Tile> tiles;
+
+    // Resident tiles from the most recently used one, along with their total size
+    std::list<size_t> recent;
+    size_t resident_size = 0;
+
+    std::vector<size_t> requests;
+    std::mutex mutex;
+
+    // Tiles a batch of rays looked up already, each taken from the cache once for the whole batch
+    struct Lookup {
+        std::shared_ptr<const FlatGridTree> tree;
+        bool missed = false;
+    };
+    typedef std::unordered_map<size_t, Lookup> Lookups;
+
+public:
+    size_t tile_size = 0;
+    size_t columns = 0;
+    size_t rows = 0;
+
+    // Bytes of resident tiles to stay within, besides the ones still being cast through
+    size_t budget = 256 << 20;
+    TileMiss miss = TileMiss::Load;
+
+    bool load(const std::string& file_name);
+
+    size_t span() const;
+    size_t residentTiles();
+    size_t residentBytes();
+
+    size_t pageRequested(size_t limit = SIZE_MAX);
+
+    RayHit cast(SDL_FPoint origin, float angle, CastEngine engine = CastEngine::Parametric);
+    void castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                   CastEngine engine = CastEngine::Parametric);
+
+private:
+    RayHit cast(SDL_FPoint origin, float angle, CastEngine engine, Lookups& lookups);
+    const Lookup& lookup(size_t index, Lookups& lookups);
+    std::shared_ptr<const FlatGridTree> acquire(size_t index, bool& missed);
+    void insert(size_t index, std::shared_ptr<const FlatGridTree> tree);
+};
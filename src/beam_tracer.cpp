@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cmath>
+
+#include "beam_tracer.hpp"
+
+
+// Depth in front of the camera which segments are clipped to, short of dividing by zero
+static const float NEAR_DEPTH = 1e-6f;
+
+BeamFrustum::BeamFrustum(SDL_FPoint origin, float angle, float fov, int columns)
+    : origin(origin), forward{std::sin(angle), std::cos(angle)},
+      right{std::cos(angle), -std::sin(angle)}, angle(angle), field(std::tan(fov / 2.0f)),
+      columns(columns) {}
+
+bool BeamFrustum::span(SDL_FPoint from, SDL_FPoint to, int& begin, int& end) const {
+    // Depth along the view direction, and offset to its right
+    float z[2], s[2];
+    const SDL_FPoint points[2] = {from, to};
+    for (int i = 0; i < 2; i++) {
+        float x = points[i].x - this->origin.x;
+        float y = points[i].y - this->origin.y;
+        z[i] = x * this->forward.x + y * this->forward.y;
+        s[i] = x * this->right.x + y * this->right.y;
+    }
+
+    // Clips the segment to what lies in front of the camera
+    if (z[0] < NEAR_DEPTH && z[1] < NEAR_DEPTH) {
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (z[i] < NEAR_DEPTH) {
+            int j = 1 - i;
+            float t = (NEAR_DEPTH - z[j]) / (z[i] - z[j]);
+            s[i] = s[j] + t * (s[i] - s[j]);
+            z[i] = NEAR_DEPTH;
+        }
+    }
+
+    // Column x sits at (2x / columns - 1) * field across the view, clamped short of overflowing
+    float u[2];
+    for (int i = 0; i < 2; i++) {
+        u[i] = std::clamp((s[i] / (z[i] * this->field) + 1.0f) * this->columns / 2.0f, -1.0f,
+                          this->columns + 1.0f);
+    }
+
+    begin = std::max((int)std::ceil(std::min(u[0], u[1])), 0);
+    end = std::min((int)std::floor(std::max(u[0], u[1])) + 1, this->columns);
+    return begin < end;
+}
+
+bool BeamFrustum::box(float x_mid, float y_mid, float half, int& begin, int& end) const {
+    // Spans the columns of its edges, as the near clipped box reaches its extremes along them
+    const SDL_FPoint corners[4] = {{x_mid + half, y_mid + half},
+                                   {x_mid - half, y_mid + half},
+                                   {x_mid - half, y_mid - half},
+                                   {x_mid + half, y_mid - half}};
+    begin = this->columns;
+    end = 0;
+    for (int i = 0; i < 4; i++) {
+        int edge_begin, edge_end;
+        if (this->span(corners[i], corners[(i + 1) % 4], edge_begin, edge_end)) {
+            begin = std::min(begin, edge_begin);
+            end = std::max(end, edge_end);
+        }
+    }
+
+    // Widens by a column against rounding, culling less rather than dropping one
+    begin = std::max(begin - 1, 0);
+    end = std::min(end + 1, this->columns);
+    return begin < end;
+}
+
+float BeamFrustum::depth(HitFace face, float plane, int column) const {
+    // Follows the ray at its own angle as the raycasters do, which stays accurate on grazing faces
+    float angle = this->angle + std::atan((2.0f * column / this->columns - 1.0f) * this->field);
+    bool face_x = face == HitFace::XPos || face == HitFace::XNeg;
+    float t = face_x ? (plane - this->origin.x) / std::sin(angle)
+                     : (plane - this->origin.y) / std::cos(angle);
+
+    // Undoes the fish-eye effect
+    return t * std::cos(angle - this->angle);
+}
+
+void BeamTracer::reset(int columns) {
+    this->gaps.clear();
+    this->spans.clear();
+    if (columns > 0) {
+        this->gaps.push_back(Gap{0, columns});
+    }
+}
+
+bool BeamTracer::covered(int begin, int end) const {
+    // Finds the first gap ending past the columns' start
+    auto gap = std::upper_bound(this->gaps.begin(), this->gaps.end(), begin,
+                                [](int column, const Gap& gap) { return column < gap.end; });
+    return gap == this->gaps.end() || gap->begin >= end;
+}
+
+bool BeamTracer::done() const {
+    return this->gaps.empty();
+}
+
+void BeamTracer::cover(int begin, int end, FaceSpan face, float plane, const BeamFrustum& frustum) {
+    auto gap = std::upper_bound(this->gaps.begin(), this->gaps.end(), begin,
+                                [](int column, const Gap& gap) { return column < gap.end; });
+
+    while (gap != this->gaps.end() && gap->begin < end) {
+        // Emits the part of the face seen through the gap
+        face.begin = std::max(gap->begin, begin);
+        face.end = std::min(gap->end, end);
+        face.depths[0] = frustum.depth(face.face, plane, face.begin);
+        face.depths[1] = frustum.depth(face.face, plane, face.end - 1);
+        this->spans.push_back(face);
+
+        // Keeps whatever the face leaves uncovered on either side
+        bool left = gap->begin < face.begin;
+        bool right = face.end < gap->end;
+        if (left && right) {
+            Gap rest = {face.end, gap->end};
+            gap->end = face.begin;
+            gap = this->gaps.insert(gap + 1, rest) + 1;
+        }
+        else if (left) {
+            gap->end = face.begin;
+            gap++;
+        }
+        else if (right) {
+            gap->begin = face.end;
+            gap++;
+        }
+        else {
+            gap = this->gaps.erase(gap);
+        }
+    }
+}
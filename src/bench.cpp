@@ -0,0 +1,806 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "beam_tracer.hpp"
+#include "cast_stats.hpp"
+#include "entity_tree.hpp"
+#include "flat_grid_tree.hpp"
+#include "grid_map.hpp"
+#include "grid_tree.hpp"
+#include "map_generator.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+#ifdef QUADCASTER_EMBEDDED_MAP
+#include "embedded_map.hpp"
+#endif
+
+
+/*
+ * Headless benchmark of map loading, tree building and raycasting, printing a JSON object per line.
+ *
+ * Every map is loaded back from a text file, treeified (in parallel and top-down as it used to be as
+ * well, both of which must match the serial build), flattened (once more sharing alike subtrees), and
+ * then cast through along fixed camera paths, each frame casting one ray per column as the renderer
+ * would, or tracing a single beam with `--beam`. Circle overlap and nearest solid queries are
+ * then run for agents scattered over the map, along with line of sight between the first thousand of
+ * them, which then move about as entities, found in view and culled behind walls along the orbit. The
+ * benchmark is built with `QUADCASTER_STATS`, counting the nodes and empty quadrants stepped into per
+ * ray as well.
+ */
+
+struct Options {
+    std::vector<std::string> maps;
+    size_t size = 1024;
+    float density = 0.2f;
+    uint32_t seed = 1;
+    int columns = 1920;
+    int frames = 240;
+    float fov = M_PI_2;
+    size_t workers = 0;
+    CastEngine engine = CastEngine::Parametric;
+    bool flat = false;
+    bool shared = false;
+    bool clearance = false;
+    bool beam = false;
+    float lod = 0.0f; // Pixels below which rays stop refining nodes, none when zero
+    size_t agents = 100000;
+};
+
+struct CameraPath {
+    const char* name;
+    std::function<void(int frame, int frames, SDL_FPoint& pos, float& angle)> at;
+};
+
+// Paths stay the same across releases, so that their timings remain comparable
+const CameraPath CAMERA_PATHS[] = {
+    // Circles around the center, looking ahead
+    {"orbit",
+     [](int frame, int frames, SDL_FPoint& pos, float& angle) {
+         float theta = 2.0f * M_PI * frame / frames;
+         pos = {0.5f * std::sin(theta), 0.5f * std::cos(theta)};
+         angle = theta + M_PI_2;
+     }},
+    // Turns around in place at the center
+    {"spin",
+     [](int frame, int frames, SDL_FPoint& pos, float& angle) {
+         pos = {0.01f, 0.01f};
+         angle = 2.0f * M_PI * frame / frames;
+     }},
+    // Walks diagonally across the whole map
+    {"diagonal",
+     [](int frame, int frames, SDL_FPoint& pos, float& angle) {
+         float t = -0.95f + 1.9f * frame / frames;
+         pos = {t, t};
+         angle = M_PI_4;
+     }},
+};
+
+static const char* engineName(CastEngine engine) {
+    switch (engine) {
+        case CastEngine::Recursive:
+            return "recursive";
+        case CastEngine::Parametric:
+            return "parametric";
+        case CastEngine::Roped:
+            return "roped";
+        case CastEngine::Exact:
+            return "exact";
+    }
+
+    return "";
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long peakResidentKilobytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+static double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+
+    // Picks the nearest rank
+    std::sort(samples.begin(), samples.end());
+    return samples[(size_t)std::round(p * (samples.size() - 1))];
+}
+
+// Builds a tree the way `GridMap::treeify` used to, top-down through a throwaway node per quadrant,
+// as a reference for the bottom-up build to match and to be timed against
+static void treeifyTopDown(const GridMap& map, GridTree& tree, size_t x_start, size_t y_start,
+                           size_t size) {
+    if (size == 1) {
+        tree.color = GRID_PALETTE[map.getAt(x_start, y_start)];
+        return;
+    }
+
+    size_t half = size / 2;
+    for (int i = 0b00; i <= 0b11; i++) {
+        bool x_pos = i & 0b01;
+        bool y_pos = i & 0b10;
+        tree.setQuadrant(x_pos, y_pos, GridTree());
+
+        // Rows grow downwards, hence Y+ quadrants start at the top
+        GridTree& quadrant = tree.getQuadrant(x_pos, y_pos);
+        size_t x = x_start + (x_pos ? half : 0);
+        size_t y = y_start + (y_pos ? 0 : half);
+        treeifyTopDown(map, quadrant, x, y, half);
+        if (quadrant.isLeaf() && quadrant.color.a == 0) {
+            tree.clearQuadrant(x_pos, y_pos);
+        }
+    }
+
+    tree.prune();
+}
+
+// Whether both trees have the same shape and colors, branches included
+static bool sameTree(GridTree& a, GridTree& b) {
+    const SDL_Color& p = a.color;
+    const SDL_Color& q = b.color;
+    if (p.r != q.r || p.g != q.g || p.b != q.b || p.a != q.a) {
+        return false;
+    }
+
+    for (int i = 0b00; i <= 0b11; i++) {
+        bool x_pos = i & 0b01;
+        bool y_pos = i & 0b10;
+        if (a.hasQuadrant(x_pos, y_pos) != b.hasQuadrant(x_pos, y_pos)) {
+            return false;
+        }
+        if (a.hasQuadrant(x_pos, y_pos) &&
+            !sameTree(a.getQuadrant(x_pos, y_pos), b.getQuadrant(x_pos, y_pos))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--map" && has_value) {
+            options.maps.push_back(argv[++i]);
+        }
+        else if (arg == "--size" && has_value) {
+            options.size = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--density" && has_value) {
+            options.density = std::atof(argv[++i]);
+        }
+        else if (arg == "--seed" && has_value) {
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--columns" && has_value) {
+            options.columns = std::atoi(argv[++i]);
+        }
+        else if (arg == "--frames" && has_value) {
+            options.frames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && has_value) {
+            int threads = std::atoi(argv[++i]);
+            options.workers = threads > 1 ? threads - 1 : 0;
+        }
+        else if (arg == "--engine" && has_value) {
+            std::string name = argv[++i];
+            options.engine = name == "recursive" ? CastEngine::Recursive
+                             : name == "roped"   ? CastEngine::Roped
+                             : name == "exact"   ? CastEngine::Exact
+                                                 : CastEngine::Parametric;
+        }
+        else if (arg == "--flat") {
+            options.flat = true;
+        }
+        else if (arg == "--shared") {
+            options.shared = true;
+        }
+        else if (arg == "--clearance") {
+            options.clearance = true;
+        }
+        else if (arg == "--beam") {
+            options.beam = true;
+        }
+        else if (arg == "--lod" && has_value) {
+            options.lod = std::max((float)std::atof(argv[++i]), 0.0f);
+        }
+        else if (arg == "--agents" && has_value) {
+            options.agents = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--map noise|maze|caves|rooms|embedded|FILE]... [--size N] [--density D]"
+                         " [--seed S] [--columns W] [--frames F] [--threads T]"
+                         " [--engine recursive|parametric|roped|exact] [--flat] [--shared]"
+                         " [--clearance] [--beam] [--lod PIXELS]"
+                         " [--agents N]\n";
+            return false;
+        }
+    }
+
+    // Runs every generator, along with the shipped maps and the one compiled in by default
+    if (options.maps.empty()) {
+        options.maps = {"noise", "maze", "caves", "rooms"};
+        for (const auto& entry : std::filesystem::directory_iterator("maps")) {
+            if (entry.path().extension() == ".txt") {
+                options.maps.push_back(entry.path().string());
+            }
+        }
+        std::sort(options.maps.begin() + 4, options.maps.end());
+#ifdef QUADCASTER_EMBEDDED_MAP
+        options.maps.push_back("embedded");
+#endif
+    }
+
+    return true;
+}
+
+static void benchmarkMap(const Options& options, const std::string& name, ThreadPool& pool) {
+    std::ostringstream json;
+    json << "{\"map\": \"" << name << "\"";
+
+    // Generated maps go through a text file as well, so that loading is always measured
+    std::string file_name = name;
+    MapKind kind;
+    if (parseMapKind(name, kind)) {
+        auto start = std::chrono::steady_clock::now();
+        GridMap generated = generateMap(kind, options.size, options.density, options.seed);
+        json << ", \"density\": " << options.density << ", \"seed\": " << options.seed
+             << ", \"generate_ms\": " << millisecondsSince(start);
+
+        auto path = std::filesystem::temp_directory_path() / ("quadcaster-bench-" + name + ".txt");
+        file_name = path.string();
+        generated.save(file_name);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    GridMap map(file_name);
+    json << ", \"width\": " << map.width << ", \"height\": " << map.height
+         << ", \"load_ms\": " << millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    GridTree tree = map.treeify();
+    double treeify_ms = millisecondsSince(start);
+
+    // Builds the same tree again across every thread, for its speedup over the serial build
+    double parallel_ms;
+    bool parallel_identical;
+    {
+        start = std::chrono::steady_clock::now();
+        GridTree parallel_tree = map.treeify(pool);
+        parallel_ms = millisecondsSince(start);
+        parallel_identical = sameTree(tree, parallel_tree);
+    }
+    json << ", \"treeify_ms\": " << treeify_ms << ", \"treeify_parallel_ms\": " << parallel_ms
+         << ", \"treeify_speedup\": " << treeify_ms / parallel_ms
+         << ", \"treeify_parallel_identical\": " << (parallel_identical ? "true" : "false");
+
+    // Builds it once more top-down as before, which the bottom-up build must match node for node
+    double top_down_ms;
+    bool top_down_identical;
+    {
+        start = std::chrono::steady_clock::now();
+        GridTree top_down_tree;
+        treeifyTopDown(map, top_down_tree, 0, 0, nextPowerOfTwo(std::max(map.width, map.height)));
+        top_down_ms = millisecondsSince(start);
+        top_down_identical = sameTree(tree, top_down_tree);
+    }
+    json << ", \"treeify_top_down_ms\": " << top_down_ms
+         << ", \"treeify_top_down_identical\": " << (top_down_identical ? "true" : "false");
+
+    // Builds it in place as well, filling the whole map solid before writing every run of blocks
+    // in each row over it, the empty ones erasing what was filled in
+    double edit_ms;
+    bool edit_identical;
+    {
+        start = std::chrono::steady_clock::now();
+        GridTree edited_tree;
+        size_t size = edited_tree.setRect(1, 0, 0, map.width, map.height, GRID_PALETTE[1]);
+        for (size_t y = 0; y < map.height; y++) {
+            for (size_t x = 0; x < map.width;) {
+                uint8_t index = map.getAt(x, y);
+                size_t run = 1;
+                while (x + run < map.width && map.getAt(x + run, y) == index) {
+                    run++;
+                }
+                size = edited_tree.setRect(size, x, y, run, 1, GRID_PALETTE[index]);
+                x += run;
+            }
+        }
+        edit_ms = millisecondsSince(start);
+        edit_identical = sameTree(tree, edited_tree);
+    }
+    json << ", \"edit_ms\": " << edit_ms
+         << ", \"edit_identical\": " << (edit_identical ? "true" : "false");
+    if (!parallel_identical || !top_down_identical || !edit_identical) {
+        std::cerr << "Trees of `" << name << "` differ between builds!\n";
+    }
+
+    start = std::chrono::steady_clock::now();
+    FlatGridTree flat(tree);
+    json << ", \"flatten_ms\": " << millisecondsSince(start);
+
+    TreeStats shape = tree.stats();
+    json << ", \"nodes\": " << shape.nodes << ", \"depth\": " << shape.depths.size() - 1
+         << ", \"tree_bytes\": " << shape.bytes << ", \"flat_bytes\": " << flat.bytes();
+
+    // Shares alike subtrees, reporting how much of the flat tree they saved
+    start = std::chrono::steady_clock::now();
+    FlatGridTree shared(tree, true);
+    json << ", \"share_ms\": " << millisecondsSince(start) << ", \"shared_bytes\": " << shared.bytes()
+         << ", \"shared_ratio\": " << (double)flat.bytes() / shared.bytes();
+
+    // With `--shared`, the shared tree is cast through in place of the flat one
+    bool use_flat = options.flat || options.shared || options.engine == CastEngine::Roped;
+    if (options.shared) {
+        flat = shared;
+    }
+    if (options.engine == CastEngine::Roped) {
+        start = std::chrono::steady_clock::now();
+        flat.rope();
+        json << ", \"rope_ms\": " << millisecondsSince(start)
+             << ", \"rope_bytes\": " << flat.ropeBytes();
+    }
+
+    // Representative colors only exist on the pointer tree, which is then cast through instead
+    float footprint = pixelFootprint(options.fov, options.columns, options.lod);
+    if (options.lod > 0.0f) {
+        use_flat = false;
+        json << ", \"lod\": " << options.lod;
+    }
+
+    // Clearance is only measured on the pointer tree, which is then cast through instead
+    if (options.clearance) {
+        use_flat = false;
+        start = std::chrono::steady_clock::now();
+        tree.measureClearance();
+        json << ", \"clearance_ms\": " << millisecondsSince(start);
+    }
+
+    // Roped trees are also cast through one ray at a time with the parametric engine, which walking
+    // along the ropes is meant to beat, as packets of it only apply to the pointer and flat trees alike
+    bool compare_scalar = use_flat && flat.roped() && !options.beam;
+
+    // Rays skipping ahead through the clearance are checked against the flat tree, which has none
+    bool compare_clearance = options.clearance && options.lod <= 0.0f && !options.beam;
+
+    // Casts along every camera path, comparing rays stopped at the footprint against refining them
+    std::vector<float> angles(options.columns);
+    std::vector<RayHit> hits(options.columns);
+    std::vector<RayHit> detailed_hits(options.columns);
+    float field = std::tan(options.fov / 2.0f);
+    BeamTracer tracer;
+
+    json << ", \"engine\": \"" << engineName(options.engine) << "\", \"tree\": \""
+         << (!use_flat ? "pointer" : flat.shared() ? "shared" : "flat") << "\", \"tracing\": \""
+         << (options.beam ? "beam" : "rays")
+         << "\", \"threads\": " << pool.size() + 1
+         << ", \"columns\": " << options.columns << ", \"frames\": " << options.frames
+         << ", \"paths\": {";
+
+    for (const CameraPath& path : CAMERA_PATHS) {
+        std::vector<double> frame_ms;
+        size_t hit_count = 0;
+        size_t face_count = 0;
+        std::atomic<size_t> node_count = 0;
+        std::atomic<size_t> empty_count = 0;
+        size_t lod_changes = 0;
+        std::vector<double> scalar_ms;
+        std::atomic<size_t> scalar_node_count = 0;
+        size_t scalar_mismatches = 0;
+        size_t clearance_mismatches = 0;
+
+        for (int frame = 0; frame < options.frames; frame++) {
+            SDL_FPoint pos;
+            float angle;
+            path.at(frame, options.frames, pos, angle);
+
+            for (int x = 0; x < options.columns; x++) {
+                float camera_x = remap(x, 0.0, options.columns, -1.0, 1.0);
+                angles[x] = angle + std::atan(camera_x * field);
+            }
+
+            // Traces the whole frame as a beam on the calling thread, with the columns covered as hits
+            if (options.beam) {
+                auto frame_start = std::chrono::steady_clock::now();
+                castStats = CastStats();
+                if (use_flat) {
+                    flat.traceBeam(pos, angle, options.fov, options.columns, tracer);
+                }
+                else {
+                    tree.traceBeam(pos, angle, options.fov, options.columns, tracer);
+                }
+                frame_ms.push_back(millisecondsSince(frame_start));
+                node_count += castStats.nodes;
+                empty_count += castStats.empty;
+
+                face_count += tracer.spans.size();
+                for (const FaceSpan& span : tracer.spans) {
+                    hit_count += span.end - span.begin;
+                }
+                continue;
+            }
+
+            auto frame_start = std::chrono::steady_clock::now();
+            pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                auto angle_range = std::span(angles).subspan(begin, end - begin);
+                auto hit_range = std::span(hits).subspan(begin, end - begin);
+                castStats = CastStats();
+                if (use_flat) {
+                    flat.castBatch(pos, angle_range, hit_range, options.engine);
+                }
+                else {
+                    tree.castBatch(pos, angle_range, hit_range, options.engine, footprint);
+                }
+                node_count += castStats.nodes;
+                empty_count += castStats.empty;
+            });
+            frame_ms.push_back(millisecondsSince(frame_start));
+
+            for (const RayHit& hit : hits) {
+                hit_count += hit.hit;
+            }
+
+            // Casts the same frame once more ray by ray through the parametric engine, timed apart
+            if (compare_scalar) {
+                auto scalar_start = std::chrono::steady_clock::now();
+                pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                    castStats = CastStats();
+                    for (size_t x = begin; x < end; x++) {
+                        detailed_hits[x] = flat.cast(pos, angles[x], CastEngine::Parametric);
+                    }
+                    scalar_node_count += castStats.nodes;
+                });
+                scalar_ms.push_back(millisecondsSince(scalar_start));
+
+                // Counts the rays the ropes led elsewhere than scalar casts, to another leaf or none
+                for (int x = 0; x < options.columns; x++) {
+                    const RayHit& a = hits[x];
+                    const RayHit& b = detailed_hits[x];
+                    scalar_mismatches += a.hit != b.hit || (a.hit && (a.leaf.x != b.leaf.x ||
+                                                                      a.leaf.y != b.leaf.y));
+                }
+            }
+
+            // Counts the rays skipping ahead led to another leaf than stepping through every empty
+            // quadrant, which only rays grazing the corner of a block should be, as rounding goes
+            if (compare_clearance) {
+                CastEngine engine =
+                    options.engine == CastEngine::Roped ? CastEngine::Parametric : options.engine;
+                pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                    auto angle_range = std::span(angles).subspan(begin, end - begin);
+                    auto hit_range = std::span(detailed_hits).subspan(begin, end - begin);
+                    flat.castBatch(pos, angle_range, hit_range, engine);
+                });
+                for (int x = 0; x < options.columns; x++) {
+                    const RayHit& a = hits[x];
+                    const RayHit& b = detailed_hits[x];
+                    clearance_mismatches += a.hit != b.hit || (a.hit && (a.leaf.x != b.leaf.x ||
+                                                                         a.leaf.y != b.leaf.y));
+                }
+            }
+
+            // Counts the columns whose wall or color the level of detail changed, outside the timings
+            if (options.lod > 0.0f) {
+                pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                    auto angle_range = std::span(angles).subspan(begin, end - begin);
+                    auto hit_range = std::span(detailed_hits).subspan(begin, end - begin);
+                    tree.castBatch(pos, angle_range, hit_range, options.engine);
+                });
+                for (int x = 0; x < options.columns; x++) {
+                    const RayHit& a = hits[x];
+                    const RayHit& b = detailed_hits[x];
+                    lod_changes += a.hit != b.hit || a.color.r != b.color.r || a.color.g != b.color.g ||
+                                   a.color.b != b.color.b;
+                }
+            }
+        }
+
+        double total_ms = 0.0;
+        for (double ms : frame_ms) {
+            total_ms += ms;
+        }
+
+        json << (&path == CAMERA_PATHS ? "" : ", ") << "\"" << path.name << "\": {"
+             << "\"rays_per_sec\": " << options.columns * frame_ms.size() / (total_ms / 1000.0)
+             << ", \"frame_p50_ms\": " << percentile(frame_ms, 0.50)
+             << ", \"frame_p99_ms\": " << percentile(frame_ms, 0.99)
+             << ", \"hit_ratio\": " << (double)hit_count / (options.columns * frame_ms.size())
+             << ", \"nodes_per_ray\": " << (double)node_count / (options.columns * frame_ms.size())
+             << ", \"empty_per_ray\": " << (double)empty_count / (options.columns * frame_ms.size());
+        if (options.beam) {
+            json << ", \"faces_per_frame\": " << (double)face_count / frame_ms.size();
+        }
+        if (options.lod > 0.0f) {
+            json << ", \"lod_changed_ratio\": "
+                 << (double)lod_changes / (options.columns * frame_ms.size());
+        }
+        if (compare_scalar) {
+            double scalar_total_ms = 0.0;
+            for (double ms : scalar_ms) {
+                scalar_total_ms += ms;
+            }
+            json << ", \"scalar_rays_per_sec\": "
+                 << options.columns * scalar_ms.size() / (scalar_total_ms / 1000.0)
+                 << ", \"scalar_nodes_per_ray\": "
+                 << (double)scalar_node_count / (options.columns * scalar_ms.size())
+                 << ", \"scalar_hit_mismatches\": " << scalar_mismatches;
+        }
+        if (compare_clearance) {
+            json << ", \"clearance_hit_mismatches\": " << clearance_mismatches;
+        }
+        json << "}";
+    }
+
+    json << "}";
+
+    // Queries the surroundings of agents scattered over the map, as a simulation would every tick
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    std::vector<SDL_FPoint> agents(options.agents);
+    for (SDL_FPoint& agent : agents) {
+        agent = {coordinate(random), coordinate(random)};
+    }
+
+    float block = 2.0f / nextPowerOfTwo(std::max(map.width, map.height));
+    std::vector<uint8_t> overlaps(agents.size());
+    std::vector<SolidHit> nearest(agents.size());
+
+    start = std::chrono::steady_clock::now();
+    if (use_flat) {
+        flat.overlapsCircleBatch(agents, block / 4.0f, overlaps, &pool);
+    }
+    else {
+        tree.overlapsCircleBatch(agents, block / 4.0f, overlaps, &pool);
+    }
+    double circle_ms = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    if (use_flat) {
+        flat.nearestSolidBatch(agents, block * 8.0f, nearest, &pool);
+    }
+    else {
+        tree.nearestSolidBatch(agents, block * 8.0f, nearest, &pool);
+    }
+    double nearest_ms = millisecondsSince(start);
+
+    // Checks sight between every pair among the first agents, mirrored across the diagonal
+    size_t viewer_count = std::min(agents.size(), (size_t)1000);
+    std::span<const SDL_FPoint> viewers = std::span(agents).first(viewer_count);
+    std::vector<uint8_t> sight(viewers.size() * viewers.size());
+    start = std::chrono::steady_clock::now();
+    if (use_flat) {
+        flat.lineOfSight(viewers, viewers, sight, &pool);
+    }
+    else {
+        tree.lineOfSight(viewers, viewers, sight, &pool);
+    }
+    double sight_ms = millisecondsSince(start);
+
+    json << ", \"agents\": " << agents.size()
+         << ", \"circle_queries_per_sec\": " << agents.size() / (circle_ms / 1000.0)
+         << ", \"nearest_queries_per_sec\": " << agents.size() / (nearest_ms / 1000.0)
+         << ", \"sight_checks_per_sec\": " << sight.size() / (sight_ms / 1000.0);
+
+    // Walks the agents about as moving entities for a few ticks, relinking those leaving their cell
+    EntityTree entities;
+    std::vector<SDL_FPoint> steps(agents.size());
+    std::uniform_real_distribution<float> step(-block / 4.0f, block / 4.0f);
+    for (size_t i = 0; i < agents.size(); i++) {
+        entities.add(Entity{.pos = agents[i], .radius = block * 0.3f});
+        steps[i] = {step(random), step(random)};
+    }
+
+    const int TICKS = 10;
+    start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < TICKS; tick++) {
+        for (uint32_t id = 0; id < entities.size(); id++) {
+            SDL_FPoint pos = entities.get(id).pos;
+            entities.move(id, {pos.x + steps[id].x, pos.y + steps[id].y});
+        }
+    }
+    double move_ms = millisecondsSince(start);
+
+    // Finds the entities in view along the orbit, then culls those behind the walls rays hit
+    std::vector<float> depths(options.columns);
+    std::vector<EntityView> views;
+    double frustum_ms = 0.0;
+    double cull_ms = 0.0;
+    size_t visible_count = 0;
+    size_t hidden_count = 0;
+    for (int frame = 0; frame < options.frames; frame++) {
+        SDL_FPoint pos;
+        float angle;
+        CAMERA_PATHS[0].at(frame, options.frames, pos, angle);
+
+        for (int x = 0; x < options.columns; x++) {
+            float camera_x = remap(x, 0.0, options.columns, -1.0, 1.0);
+            angles[x] = angle + std::atan(camera_x * field);
+        }
+        pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+            auto angle_range = std::span(angles).subspan(begin, end - begin);
+            auto hit_range = std::span(hits).subspan(begin, end - begin);
+            if (use_flat) {
+                flat.castBatch(pos, angle_range, hit_range, options.engine);
+            }
+            else {
+                tree.castBatch(pos, angle_range, hit_range, options.engine);
+            }
+        });
+        for (int x = 0; x < options.columns; x++) {
+            SDL_FPoint to = {hits[x].locus.x - pos.x, hits[x].locus.y - pos.y};
+            depths[x] = hits[x].hit ? to.x * std::sin(angle) + to.y * std::cos(angle)
+                                    : std::numeric_limits<float>::infinity();
+        }
+
+        start = std::chrono::steady_clock::now();
+        entities.queryFrustum(pos, angle, options.fov, options.columns,
+                              std::numeric_limits<float>::infinity(), views);
+        frustum_ms += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        hidden_count += cullOccluded(views, depths);
+        cull_ms += millisecondsSince(start);
+        visible_count += views.size();
+    }
+
+    json << ", \"entity_moves_per_sec\": " << entities.size() * TICKS / (move_ms / 1000.0)
+         << ", \"frustum_ms\": " << frustum_ms / options.frames
+         << ", \"cull_ms\": " << cull_ms / options.frames
+         << ", \"entities_drawn\": " << (double)visible_count / options.frames
+         << ", \"entities_hidden\": " << (double)hidden_count / options.frames;
+
+    json << ", \"peak_rss_kb\": " << peakResidentKilobytes() << "}";
+    std::cout << json.str() << std::endl;
+}
+
+#ifdef QUADCASTER_EMBEDDED_MAP
+/*
+ * Compares the map compiled in as a static grid tree against building the tree of the same text map at
+ * runtime, casting along the same camera paths. The static tree is always cast through with the exact
+ * engine it is specialized for, and so is the runtime one for a like for like speedup, cast once more
+ * with the engine asked for when that is another one.
+ */
+static void benchmarkEmbedded(const Options& options, ThreadPool& pool) {
+    std::ostringstream json;
+    TreeStats shape = EMBEDDED_MAP.stats();
+    json << "{\"map\": \"embedded\", \"source\": \"" << EMBEDDED_MAP_SOURCE << "\", \"width\": "
+         << EMBEDDED_MAP.width << ", \"height\": " << EMBEDDED_MAP.height
+         << ", \"static_nodes\": " << EMBEDDED_MAP.size() << ", \"depth\": " << shape.depths.size() - 1
+         << ", \"static_bytes\": " << EMBEDDED_MAP.bytes();
+
+    // Loads and builds at runtime what the static tree holds from the start
+    auto start = std::chrono::steady_clock::now();
+    GridMap map(EMBEDDED_MAP_SOURCE);
+    GridTree tree = map.treeify();
+    double startup_ms = millisecondsSince(start);
+    if (map.width != EMBEDDED_MAP.width || map.height != EMBEDDED_MAP.height) {
+        std::cerr << "Map `" << EMBEDDED_MAP_SOURCE << "` changed since it was compiled in!\n";
+        return;
+    }
+
+    json << ", \"runtime_startup_ms\": " << startup_ms << ", \"runtime_bytes\": " << tree.stats().bytes
+         << ", \"static_engine\": \"exact\", \"engine\": \"" << engineName(options.engine)
+         << "\", \"threads\": " << pool.size() + 1
+         << ", \"columns\": " << options.columns << ", \"frames\": " << options.frames
+         << ", \"paths\": {";
+
+    std::vector<float> angles(options.columns);
+    std::vector<RayHit> static_hits(options.columns);
+    std::vector<RayHit> runtime_hits(options.columns);
+    float field = std::tan(options.fov / 2.0f);
+
+    for (const CameraPath& path : CAMERA_PATHS) {
+        double static_ms = 0.0;
+        double runtime_ms = 0.0;
+        double engine_ms = 0.0;
+        size_t mismatches = 0;
+
+        for (int frame = 0; frame < options.frames; frame++) {
+            SDL_FPoint pos;
+            float angle;
+            path.at(frame, options.frames, pos, angle);
+
+            for (int x = 0; x < options.columns; x++) {
+                float camera_x = remap(x, 0.0, options.columns, -1.0, 1.0);
+                angles[x] = angle + std::atan(camera_x * field);
+            }
+
+            start = std::chrono::steady_clock::now();
+            pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                auto angle_range = std::span(angles).subspan(begin, end - begin);
+                auto hit_range = std::span(static_hits).subspan(begin, end - begin);
+                EMBEDDED_MAP.castBatch(pos, angle_range, hit_range);
+            });
+            static_ms += millisecondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                auto angle_range = std::span(angles).subspan(begin, end - begin);
+                auto hit_range = std::span(runtime_hits).subspan(begin, end - begin);
+                tree.castBatch(pos, angle_range, hit_range, CastEngine::Exact);
+            });
+            runtime_ms += millisecondsSince(start);
+
+            for (int x = 0; x < options.columns; x++) {
+                mismatches += static_hits[x].hit != runtime_hits[x].hit;
+            }
+
+            if (options.engine != CastEngine::Exact) {
+                start = std::chrono::steady_clock::now();
+                pool.parallelFor(options.columns, 64, [&](size_t begin, size_t end) {
+                    auto angle_range = std::span(angles).subspan(begin, end - begin);
+                    auto hit_range = std::span(runtime_hits).subspan(begin, end - begin);
+                    tree.castBatch(pos, angle_range, hit_range, options.engine);
+                });
+                engine_ms += millisecondsSince(start);
+            }
+        }
+
+        double rays = (double)options.columns * options.frames;
+        json << (&path == CAMERA_PATHS ? "" : ", ") << "\"" << path.name << "\": {"
+             << "\"static_rays_per_sec\": " << rays / (static_ms / 1000.0)
+             << ", \"runtime_rays_per_sec\": " << rays / (runtime_ms / 1000.0)
+             << ", \"speedup\": " << runtime_ms / static_ms << ", \"hit_mismatches\": " << mismatches;
+        if (options.engine != CastEngine::Exact) {
+            json << ", \"runtime_engine_rays_per_sec\": " << rays / (engine_ms / 1000.0)
+                 << ", \"engine_speedup\": " << engine_ms / static_ms;
+        }
+        json << "}";
+    }
+
+    json << "}, \"peak_rss_kb\": " << peakResidentKilobytes() << "}";
+    std::cout << json.str() << std::endl;
+}
+#endif
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    ThreadPool pool(options.workers);
+    for (const std::string& name : options.maps) {
+#ifdef QUADCASTER_EMBEDDED_MAP
+        if (name == "embedded") {
+            benchmarkEmbedded(options, pool);
+            continue;
+        }
+#endif
+        benchmarkMap(options, name, pool);
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+
+#include "column_sampler.hpp"
+
+
+static bool sameColor(const SDL_Color& a, const SDL_Color& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool isFaceX(HitFace face) {
+    return face == HitFace::XPos || face == HitFace::XNeg;
+}
+
+static bool agree(SDL_FPoint origin, const RayHit& a, const RayHit& b) {
+    // Rays leaving the grid say nothing about the blocks they passed by
+    if (!a.hit || !b.hit) {
+        return false;
+    }
+
+    // Facing the same way on the same leaf, which is a single square without any gaps
+    if (a.face != b.face || a.face == HitFace::None || a.leaf.x != b.leaf.x || a.leaf.y != b.leaf.y ||
+        !sameColor(a.color, b.color)) {
+        return false;
+    }
+
+    // Grazing faces change too much in depth for anything in between to be trusted
+    float depth_a = std::hypot(a.locus.x - origin.x, a.locus.y - origin.y);
+    float depth_b = std::hypot(b.locus.x - origin.x, b.locus.y - origin.y);
+    return std::max(depth_a, depth_b) <= 2.0f * std::min(depth_a, depth_b);
+}
+
+static bool intersect(SDL_FPoint origin, float angle, const RayHit& sample, RayHit& out) {
+    float dx = std::sin(angle);
+    float dy = std::cos(angle);
+
+    // Reaches the plane of the face the same way `castParametric` lands on a boundary, only within the
+    // face, whose corners cast rays may well attribute to the other face of the leaf meeting there
+    RayHit hit = sample;
+    float t;
+    if (isFaceX(sample.face)) {
+        if (dx == 0.0f) {
+            return false;
+        }
+        t = (sample.locus.x - origin.x) * (1.0f / dx);
+        hit.locus.y = origin.y + t * dy;
+        if (std::abs(hit.locus.y - sample.leaf.y) >= std::abs(sample.locus.x - sample.leaf.x)) {
+            return false;
+        }
+    }
+    else {
+        if (dy == 0.0f) {
+            return false;
+        }
+        t = (sample.locus.y - origin.y) * (1.0f / dy);
+        hit.locus.x = origin.x + t * dx;
+        if (std::abs(hit.locus.x - sample.leaf.x) >= std::abs(sample.locus.y - sample.leaf.y)) {
+            return false;
+        }
+    }
+
+    if (t < 0.0f) {
+        return false;
+    }
+
+    out = hit;
+    return true;
+}
+
+void ColumnSampler::castColumns(const std::vector<size_t>& columns, std::span<const float> angles,
+                                std::span<RayHit> out, const ColumnCaster& cast) {
+    // Gathers the columns contiguously to cast them at once, then scatters the hits back
+    this->angles.resize(columns.size());
+    this->hits.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        this->angles[i] = angles[columns[i]];
+    }
+
+    cast(this->angles, this->hits);
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        out[columns[i]] = this->hits[i];
+    }
+}
+
+size_t ColumnSampler::cast(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                           const ColumnCaster& cast, const ColumnOccluder& occluded) {
+    size_t count = std::min(angles.size(), out.size());
+    if (this->stride <= 1 || count <= 2) {
+        cast(angles.first(count), out.first(count));
+        return count;
+    }
+
+    // Casts every stride-th column, along with the last one closing off the final gap
+    this->pending.clear();
+    for (size_t x = 0; x < count; x += this->stride) {
+        this->pending.push_back(x);
+    }
+    if (this->pending.back() != count - 1) {
+        this->pending.push_back(count - 1);
+    }
+    this->castColumns(this->pending, angles, out, cast);
+    size_t casts = this->pending.size();
+
+    this->gaps.clear();
+    for (size_t i = 0; i + 1 < this->pending.size(); i++) {
+        this->gaps.push_back(Gap{this->pending[i], this->pending[i + 1]});
+    }
+
+    // Fills in the gaps between agreeing columns, bisecting the others with a round of casts each
+    while (!this->gaps.empty()) {
+        this->pending.clear();
+        this->split.clear();
+        for (Gap gap : this->gaps) {
+            if (gap.end - gap.begin <= 1) {
+                continue;
+            }
+
+            // Anything in front of the face between both columns hides it from some of the others
+            const RayHit& first = out[gap.begin];
+            const RayHit& last = out[gap.end];
+            bool filled = agree(origin, first, last) && !occluded(origin, first.locus, last.locus);
+            for (size_t x = gap.begin + 1; filled && x < gap.end; x++) {
+                filled = intersect(origin, angles[x], first, out[x]);
+            }
+
+            if (!filled) {
+                size_t middle = gap.begin + (gap.end - gap.begin) / 2;
+                this->pending.push_back(middle);
+                this->split.push_back(Gap{gap.begin, middle});
+                this->split.push_back(Gap{middle, gap.end});
+            }
+        }
+
+        this->castColumns(this->pending, angles, out, cast);
+        casts += this->pending.size();
+        std::swap(this->gaps, this->split);
+    }
+
+    return casts;
+}
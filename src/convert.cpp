@@ -0,0 +1,129 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "flat_grid_tree.hpp"
+#include "grid_map.hpp"
+#include "grid_tree.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+
+/*
+ * Converts text maps into grid tree files, which load without parsing or building the tree again.
+ *
+ * With `--tile N`, the map is cut into tiles of N blocks of a side instead, written as grid tree files
+ * next to a world manifest (see `tiled_world.hpp`). With `--header NAME`, the tree is written as a C++
+ * header instead, embedding it into programs as a `StaticGridTree` (see `static_grid_tree.hpp`). Any of
+ * them share alike subtrees between branches when preceded by `--shared`, which shrinks maps repeating
+ * the same rooms over and over, though rules out roping them.
+ */
+static bool convertTiled(const GridMap& map, size_t tile_size, bool share,
+                         const std::string& world_file) {
+    std::filesystem::path world_path = world_file;
+    std::filesystem::path tiles_name = world_path.stem().string() + "-tiles";
+    std::filesystem::create_directories(world_path.parent_path() / tiles_name);
+
+    std::ofstream fstr(world_file);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to write world file `" << world_file << "`!\n";
+        return false;
+    }
+
+    size_t columns = (map.width + tile_size - 1) / tile_size;
+    size_t rows = (map.height + tile_size - 1) / tile_size;
+    fstr << "quadcaster-world 1\n"
+         << "tile_size " << tile_size << "\n"
+         << "tiles " << columns << " " << rows << "\n";
+
+    // Writes every tile which has any blocks in it
+    size_t written = 0, bytes = 0;
+    for (size_t y = 0; y < rows; y++) {
+        for (size_t x = 0; x < columns; x++) {
+            FlatGridTree tile(map.treeify(x * tile_size, y * tile_size, tile_size), share);
+            if (tile.empty()) {
+                continue;
+            }
+
+            tile.width = tile_size;
+            tile.height = tile_size;
+            std::string tile_name = std::to_string(x) + "_" + std::to_string(y) + ".qct";
+            std::filesystem::path tile_file = tiles_name / tile_name;
+            if (!tile.save((world_path.parent_path() / tile_file).string())) {
+                return false;
+            }
+
+            fstr << "tile " << x << " " << y << " " << tile_file.generic_string() << "\n";
+            written++;
+            bytes += tile.bytes();
+        }
+    }
+
+    std::cout << world_file << " (" << columns << "x" << rows << " tiles of " << tile_size
+              << " blocks, " << written << " written, " << bytes << " bytes)\n";
+    return fstr.good();
+}
+
+int main(int argc, char** argv) {
+    size_t tile_size = 0;
+    std::string header_name;
+    bool share = argc > 1 && std::string(argv[1]) == "--shared";
+    int arg = share ? 2 : 1;
+    bool tiled = false;
+    if (argc - arg == 4 && std::string(argv[arg]) == "--tile") {
+        tile_size = std::strtoull(argv[arg + 1], nullptr, 10);
+        tiled = true;
+        arg += 2;
+    }
+    else if (argc - arg == 4 && std::string(argv[arg]) == "--header") {
+        header_name = argv[arg + 1];
+        arg += 2;
+    }
+
+    if (argc - arg != 2 || (tiled && nextPowerOfTwo(tile_size) != tile_size)) {
+        std::cerr << "Usage: " << argv[0] << " [--shared] MAP.txt OUT.qct\n"
+                  << "       " << argv[0] << " [--shared] --tile N MAP.txt OUT.qcw  (N a power of 2)\n"
+                  << "       " << argv[0] << " [--shared] --header NAME MAP.txt OUT.hpp\n";
+        return 1;
+    }
+
+    std::string map_file = argv[arg];
+    std::string out_file = argv[arg + 1];
+
+    GridMap map(map_file);
+    if (map.width == 0 || map.height == 0) {
+        std::cerr << "Map `" << map_file << "` is empty!\n";
+        return 1;
+    }
+
+    if (tile_size) {
+        return convertTiled(map, tile_size, share, out_file) ? 0 : 1;
+    }
+
+    ThreadPool pool;
+    GridTree built = map.treeify(pool);
+    FlatGridTree tree(built, share);
+    tree.width = map.width;
+    tree.height = map.height;
+
+    // Records where the map came from wherever the header is built, for comparing against it
+    if (!header_name.empty()) {
+        std::string source = std::filesystem::absolute(map_file).generic_string();
+        if (!tree.saveHeader(out_file, header_name, source)) {
+            return 1;
+        }
+    }
+    else if (!tree.save(out_file)) {
+        return 1;
+    }
+
+    std::cout << map_file << " (" << map.width << "x" << map.height << ") -> " << out_file << " ("
+              << tree.size() << " nodes, " << tree.bytes() << " bytes";
+    if (share) {
+        std::cout << ", " << FlatGridTree(built).size() << " nodes before sharing";
+    }
+    std::cout << ")\n";
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+
+#include "entity_tree.hpp"
+
+
+// End of every list of entities
+static const uint32_t NO_ENTITY = 0xFFFFFFFFu;
+
+// Loose bounds of a cell, twice as wide as the cell itself
+struct CellBounds {
+    float x_min, y_min, x_max, y_max;
+};
+
+static CellBounds looseBounds(int level, uint32_t x, uint32_t y) {
+    float side = 2.0f / (1u << level);
+    float x_min = -1.0f + x * side;
+    float y_min = -1.0f + y * side;
+    return {x_min - side / 2.0f, y_min - side / 2.0f, x_min + side * 1.5f, y_min + side * 1.5f};
+}
+
+// Largest projection of the bounds onto the axis, relative to the origin
+static float farthestAlong(const CellBounds& bounds, SDL_FPoint origin, SDL_FPoint axis) {
+    float x = axis.x > 0.0f ? bounds.x_max : bounds.x_min;
+    float y = axis.y > 0.0f ? bounds.y_max : bounds.y_min;
+    return (x - origin.x) * axis.x + (y - origin.y) * axis.y;
+}
+
+EntityTree::EntityTree(int depth) : depth(depth) {
+    size_t cells = 0;
+    for (int level = 0; level <= depth; level++) {
+        this->level_starts.push_back(cells);
+        cells += (size_t)1 << (2 * level);
+    }
+
+    this->heads.assign(cells, NO_ENTITY);
+    this->counts.assign(cells, 0);
+}
+
+size_t EntityTree::size() const {
+    return this->entities.size();
+}
+
+const Entity& EntityTree::get(uint32_t id) const {
+    return this->entities[id];
+}
+
+uint32_t EntityTree::add(const Entity& entity) {
+    uint32_t id = this->entities.size();
+    this->entities.push_back(entity);
+    this->links.push_back(Link{NO_ENTITY, NO_ENTITY, 0, 0});
+    this->link(id);
+    return id;
+}
+
+void EntityTree::move(uint32_t id, SDL_FPoint pos) {
+    this->entities[id].pos = pos;
+
+    // Stays linked where it is for as long as its center remains within the same cell
+    uint8_t level;
+    uint32_t cell;
+    this->locate(this->entities[id], level, cell);
+    if (level == this->links[id].level && cell == this->links[id].cell) {
+        return;
+    }
+
+    this->unlink(id);
+    this->link(id);
+}
+
+void EntityTree::locate(const Entity& entity, uint8_t& level, uint32_t& cell) const {
+    SDL_FPoint pos = entity.pos;
+    if (!(pos.x >= -1.0f && pos.x < 1.0f && pos.y >= -1.0f && pos.y < 1.0f)) {
+        level = 0;
+        cell = 0;
+        return;
+    }
+
+    // Goes down for as long as the cells' loose margin, half of their side, covers the entity
+    level = 0;
+    while (level < this->depth && 1.0f / (2u << level) >= entity.radius) {
+        level++;
+    }
+
+    uint32_t side = 1u << level;
+    uint32_t x = std::min((uint32_t)((pos.x + 1.0f) / 2.0f * side), side - 1);
+    uint32_t y = std::min((uint32_t)((pos.y + 1.0f) / 2.0f * side), side - 1);
+    cell = this->level_starts[level] + y * side + x;
+}
+
+void EntityTree::link(uint32_t id) {
+    Link& link = this->links[id];
+    this->locate(this->entities[id], link.level, link.cell);
+
+    link.prev = NO_ENTITY;
+    link.next = this->heads[link.cell];
+    if (link.next != NO_ENTITY) {
+        this->links[link.next].prev = id;
+    }
+    this->heads[link.cell] = id;
+
+    // Counts the entity in up to the root
+    uint32_t local = link.cell - this->level_starts[link.level];
+    uint32_t x = local & ((1u << link.level) - 1);
+    uint32_t y = local >> link.level;
+    for (int level = link.level; level >= 0; level--, x >>= 1, y >>= 1) {
+        this->counts[this->level_starts[level] + (y << level) + x]++;
+    }
+}
+
+void EntityTree::unlink(uint32_t id) {
+    const Link& link = this->links[id];
+    if (link.prev != NO_ENTITY) {
+        this->links[link.prev].next = link.next;
+    }
+    else {
+        this->heads[link.cell] = link.next;
+    }
+    if (link.next != NO_ENTITY) {
+        this->links[link.next].prev = link.prev;
+    }
+
+    uint32_t local = link.cell - this->level_starts[link.level];
+    uint32_t x = local & ((1u << link.level) - 1);
+    uint32_t y = local >> link.level;
+    for (int level = link.level; level >= 0; level--, x >>= 1, y >>= 1) {
+        this->counts[this->level_starts[level] + (y << level) + x]--;
+    }
+}
+
+template <typename Overlaps, typename Visit>
+void EntityTree::walk(int level, uint32_t x, uint32_t y, const Overlaps& overlaps,
+                       const Visit& visit) const {
+    uint32_t cell = this->level_starts[level] + (y << level) + x;
+    if (this->counts[cell] == 0) {
+        return;
+    }
+
+    // The root holds whatever strays beyond it as well, hence is never bounded
+    if (level > 0 && !overlaps(looseBounds(level, x, y))) {
+        return;
+    }
+
+    for (uint32_t id = this->heads[cell]; id != NO_ENTITY; id = this->links[id].next) {
+        visit(id);
+    }
+
+    if (level < this->depth) {
+        for (uint32_t child = 0; child < 4; child++) {
+            this->walk(level + 1, x * 2 + (child & 1), y * 2 + (child >> 1), overlaps, visit);
+        }
+    }
+}
+
+void EntityTree::queryCircle(SDL_FPoint center, float radius, std::vector<uint32_t>& out) const {
+    out.clear();
+    auto overlaps = [&](const CellBounds& bounds) {
+        float dx = std::max({bounds.x_min - center.x, 0.0f, center.x - bounds.x_max});
+        float dy = std::max({bounds.y_min - center.y, 0.0f, center.y - bounds.y_max});
+        return dx * dx + dy * dy <= radius * radius;
+    };
+
+    this->walk(0, 0, 0, overlaps, [&](uint32_t id) {
+        const Entity& entity = this->entities[id];
+        float dx = entity.pos.x - center.x;
+        float dy = entity.pos.y - center.y;
+        float reach = radius + entity.radius;
+        if (dx * dx + dy * dy <= reach * reach) {
+            out.push_back(id);
+        }
+    });
+}
+
+/*
+ * =====[Frustum query]=====
+ *
+ *    \   far   /
+ *     \       /       Cells and entities are kept when in front of the camera, before the far
+ *  left\  o  /right   distance, and on the inner side of both edges of the view, whose normals
+ *       \   /         point into it. Cells are tested by their corner farthest along each normal.
+ *        \ /
+ *         C
+ */
+void EntityTree::queryFrustum(SDL_FPoint origin, float angle, float fov, int columns, float far,
+                              std::vector<EntityView>& out) const {
+    out.clear();
+    float half = fov / 2.0f;
+    float field = std::tan(half);
+    SDL_FPoint forward = {std::sin(angle), std::cos(angle)};
+    SDL_FPoint right = {std::cos(angle), -std::sin(angle)};
+    SDL_FPoint left_normal = {std::cos(angle - half), -std::sin(angle - half)};
+    SDL_FPoint right_normal = {-std::cos(angle + half), std::sin(angle + half)};
+
+    // Edges only bound the view as long as it is narrower than a half turn
+    bool edges = half < M_PI_2;
+    SDL_FPoint backward = {-forward.x, -forward.y};
+
+    auto overlaps = [&](const CellBounds& bounds) {
+        return farthestAlong(bounds, origin, forward) >= 0.0f &&
+               -farthestAlong(bounds, origin, backward) <= far &&
+               (!edges || (farthestAlong(bounds, origin, left_normal) >= 0.0f &&
+                           farthestAlong(bounds, origin, right_normal) >= 0.0f));
+    };
+
+    this->walk(0, 0, 0, overlaps, [&](uint32_t id) {
+        const Entity& entity = this->entities[id];
+        float dx = entity.pos.x - origin.x;
+        float dy = entity.pos.y - origin.y;
+        float depth = dx * forward.x + dy * forward.y;
+
+        // Skips entities the camera stands within, which wouldn't project onto the view
+        if (depth <= entity.radius || depth - entity.radius > far) {
+            return;
+        }
+        if (edges && (dx * left_normal.x + dy * left_normal.y < -entity.radius ||
+                      dx * right_normal.x + dy * right_normal.y < -entity.radius)) {
+            return;
+        }
+
+        // Sprites face the camera, thus may fall beside the view while their circle touches its edge
+        float lateral = dx * right.x + dy * right.y;
+        float scale = columns / 2.0f / (depth * field);
+        EntityView view = {id, depth, columns / 2.0f + lateral * scale, entity.radius * scale};
+        if (view.column + view.half_width > 0.0f && view.column - view.half_width < columns) {
+            out.push_back(view);
+        }
+    });
+
+    std::sort(out.begin(), out.end(),
+              [](const EntityView& a, const EntityView& b) { return a.depth < b.depth; });
+}
+
+size_t cullOccluded(std::vector<EntityView>& views, std::span<const float> depths) {
+    int columns = depths.size();
+    size_t before = views.size();
+    std::erase_if(views, [&](const EntityView& view) {
+        int begin = std::max((int)std::floor(view.column - view.half_width), 0);
+        int end = std::min((int)std::ceil(view.column + view.half_width), columns);
+        for (int x = begin; x < end; x++) {
+            if (depths[x] > view.depth) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    return before - views.size();
+}
@@ -0,0 +1,736 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flat_grid_tree.hpp"
+#include "beam_tracer.hpp"
+#include "grid_cast.hpp"
+#include "grid_map.hpp"
+#include "grid_query.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+
+struct FlatGridTree::Cursor {
+    const FlatGridNode* nodes = nullptr;
+    FlatGridNode node = FLAT_LEAF;
+
+    bool isLeaf() const {
+        return this->node & FLAT_LEAF;
+    }
+
+    SDL_Color color() const {
+        return GRID_PALETTE[this->node & ~FLAT_LEAF];
+    }
+
+    bool quadrant(size_t index, Cursor& out) const {
+        out.nodes = this->nodes;
+        out.node = this->nodes[this->node + index];
+
+        // Empty quadrants are leaves without any palette color
+        return out.node != FLAT_LEAF;
+    }
+
+    // Empty quadrants aren't measured, being no more than a leaf word each
+    float clearance(size_t) const {
+        return 0.0f;
+    }
+};
+
+// Lone empty root of default constructed trees
+static const FlatGridNode EMPTY_ROOT = FLAT_LEAF;
+
+// Faces in the order of `FlatRopes::faces`
+enum RopeFace { ROPE_X_POS, ROPE_X_NEG, ROPE_Y_POS, ROPE_Y_NEG };
+
+struct RopeNeighbor {
+    uint32_t index = FLAT_NO_ROPE;
+    uint32_t depth = 0;
+};
+
+static void ropeSubgrid(std::span<const FlatGridNode> nodes, std::vector<FlatRopes>& ropes,
+                        uint32_t index, uint32_t depth, const RopeNeighbor (&neighbors)[4]) {
+    for (int face = 0; face < 4; face++) {
+        ropes[index].faces[face] = neighbors[face].index;
+    }
+    ropes[index].depth = depth;
+
+    FlatGridNode node = nodes[index];
+    if (node & FLAT_LEAF) {
+        return;
+    }
+
+    // Beyond the outer faces of a quadrant, a neighbor as large as this node is split into its
+    // children next to the quadrant, whereas a larger one or a leaf spans the quadrant's face anyway
+    auto beyond = [&](RopeFace face, bool x_pos, bool y_pos) {
+        RopeNeighbor neighbor = neighbors[face];
+        if (neighbor.index == FLAT_NO_ROPE || neighbor.depth != depth ||
+            (nodes[neighbor.index] & FLAT_LEAF)) {
+            return neighbor;
+        }
+
+        uint32_t child = nodes[neighbor.index] + mapQuadrantIndex(x_pos, y_pos);
+        return RopeNeighbor{child, depth + 1};
+    };
+    auto sibling = [&](bool x_pos, bool y_pos) {
+        return RopeNeighbor{node + (uint32_t)mapQuadrantIndex(x_pos, y_pos), depth + 1};
+    };
+
+    for (int x_pos = 0; x_pos < 2; x_pos++) {
+        for (int y_pos = 0; y_pos < 2; y_pos++) {
+            RopeNeighbor quadrant_neighbors[4] = {
+                x_pos ? beyond(ROPE_X_POS, false, y_pos) : sibling(true, y_pos),
+                x_pos ? sibling(false, y_pos) : beyond(ROPE_X_NEG, true, y_pos),
+                y_pos ? beyond(ROPE_Y_POS, x_pos, false) : sibling(x_pos, true),
+                y_pos ? sibling(x_pos, false) : beyond(ROPE_Y_NEG, x_pos, true),
+            };
+            uint32_t quadrant = node + mapQuadrantIndex(x_pos, y_pos);
+            ropeSubgrid(nodes, ropes, quadrant, depth + 1, quadrant_neighbors);
+        }
+    }
+}
+
+static uint32_t checksumNodes(std::span<const FlatGridNode> nodes) {
+    // FNV-1a, taking in a whole node at a time
+    uint32_t hash = 2166136261u;
+    for (FlatGridNode node : nodes) {
+        hash = (hash ^ node) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Whether any block of children is referred to by more than one branch
+static bool sharesBlocks(std::span<const FlatGridNode> nodes) {
+    std::vector<bool> referred(nodes.size());
+    for (FlatGridNode node : nodes) {
+        if (!(node & FLAT_LEAF)) {
+            if (referred[node]) {
+                return true;
+            }
+            referred[node] = true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * =====[Sharing subtrees]=====
+ *
+ *        R           #2 = [#0 #0 #1 #0]   children of R
+ *    /  / \  \       #1 = [ .  x  x  .]   children of B
+ *   A  A   B  A      #0 = [ x  .  .  x]   children of every A, kept once
+ *
+ * Every block of four children is keyed by its words, which hold either the color of a leaf or the id
+ * of the distinct block below a branch, so that alike subtrees are only ever kept once. Blocks are
+ * numbered bottom-up, then laid out from the tallest subtrees down, which keeps every block after all
+ * of the branches referring to it, as files require.
+ */
+struct FlatGridTree::SharedBlocks {
+    typedef std::array<FlatGridNode, 4> Block;
+
+    struct BlockHash {
+        size_t operator()(const Block& block) const {
+            // FNV-1a over the words, as for checksums
+            uint32_t hash = 2166136261u;
+            for (FlatGridNode node : block) {
+                hash = (hash ^ node) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> heights; // Levels of the tallest subtree in every block
+    std::unordered_map<Block, uint32_t, BlockHash> ids;
+
+    // Word of the node, referring to the id of its distinct block of children if a branch
+    FlatGridNode share(const GridTree* node) {
+        if (node->isLeaf()) {
+            return FLAT_LEAF | paletteIndex(node->color);
+        }
+
+        Block block = {FLAT_LEAF, FLAT_LEAF, FLAT_LEAF, FLAT_LEAF};
+        uint32_t height = 1;
+        for (int i = 0; i < 4; i++) {
+            if (node->quadrants[i]) {
+                block[i] = this->share(node->quadrants[i]);
+                if (!(block[i] & FLAT_LEAF)) {
+                    height = std::max(height, this->heights[block[i]] + 1);
+                }
+            }
+        }
+
+        auto [it, added] = this->ids.try_emplace(block, (uint32_t)this->blocks.size());
+        if (added) {
+            this->blocks.push_back(block);
+            this->heights.push_back(height);
+        }
+        return it->second;
+    }
+};
+
+FlatGridTree::FlatGridTree() : nodes(&EMPTY_ROOT, 1) {}
+
+FlatGridTree::FlatGridTree(const GridTree& tree, bool share) {
+    if (share) {
+        SharedBlocks shared;
+        FlatGridNode root = shared.share(&tree);
+
+        // Orders the blocks from the tallest down, keeping them bottom-up among equals
+        std::vector<uint32_t> order(shared.blocks.size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return shared.heights[a] > shared.heights[b];
+        });
+
+        std::vector<FlatGridNode> placed(shared.blocks.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            placed[order[i]] = 1 + 4 * i;
+        }
+
+        // Lays out the root on its own, then every block with its branches referring to where the
+        // blocks below ended up
+        auto built = std::make_shared<std::vector<FlatGridNode>>(1 + 4 * order.size());
+        std::vector<FlatGridNode>& nodes = *built;
+        nodes[0] = root & FLAT_LEAF ? root : placed[root];
+        for (size_t i = 0; i < order.size(); i++) {
+            for (int j = 0; j < 4; j++) {
+                FlatGridNode node = shared.blocks[order[i]][j];
+                nodes[1 + 4 * i + j] = node & FLAT_LEAF ? node : placed[node];
+            }
+        }
+
+        this->nodes = nodes;
+        this->storage = std::move(built);
+        this->sharing = sharesBlocks(this->nodes);
+        return;
+    }
+
+    auto built = std::make_shared<std::vector<FlatGridNode>>(1, FLAT_LEAF);
+    std::vector<FlatGridNode>& nodes = *built;
+
+    // Lays out the nodes breadth-first, each branch referring to a block of four children
+    std::queue<std::pair<const GridTree*, size_t>> pending;
+    pending.push({&tree, 0});
+
+    while (!pending.empty()) {
+        auto [node, index] = pending.front();
+        pending.pop();
+
+        if (node->isLeaf()) {
+            nodes[index] = FLAT_LEAF | paletteIndex(node->color);
+            continue;
+        }
+
+        // Reserves the block of children before visiting them
+        FlatGridNode block = nodes.size();
+        nodes[index] = block;
+        nodes.resize(block + 4, FLAT_LEAF);
+
+        for (int i = 0; i < 4; i++) {
+            if (node->quadrants[i]) {
+                pending.push({node->quadrants[i], block + i});
+            }
+        }
+    }
+
+    nodes.shrink_to_fit();
+    this->nodes = nodes;
+    this->storage = std::move(built);
+}
+
+bool FlatGridTree::load(const std::string& file_name) {
+    auto file = std::make_shared<MappedFile>(file_name);
+    if (!file->isOpen()) {
+        return false;
+    }
+
+    FlatGridFileHeader header;
+    if (file->size() < sizeof(header)) {
+        std::cerr << "File `" << file_name << "` is not a grid tree!\n";
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::endian::native != std::endian::little) {
+        std::cerr << "Grid tree files are only supported on little-endian machines!\n";
+        return false;
+    }
+    if (header.magic != FLAT_FILE_MAGIC) {
+        std::cerr << "File `" << file_name << "` is not a grid tree!\n";
+        return false;
+    }
+    if (header.version != FLAT_FILE_VERSION) {
+        std::cerr << "Grid tree `" << file_name << "` is of unsupported version " << header.version
+                  << "!\n";
+        return false;
+    }
+    if (header.palette > sizeof(GRID_PALETTE) / sizeof(GRID_PALETTE[0])) {
+        std::cerr << "Grid tree `" << file_name << "` uses colors beyond the palette!\n";
+        return false;
+    }
+    size_t nodes_size = (size_t)header.count * sizeof(FlatGridNode);
+    if (header.count == 0 || file->size() != sizeof(header) + nodes_size) {
+        std::cerr << "Grid tree `" << file_name << "` is truncated!\n";
+        return false;
+    }
+
+    // Casts straight through the mapped pages, which the header keeps aligned
+    auto first = (const FlatGridNode*)(file->data() + sizeof(header));
+    std::span<const FlatGridNode> nodes(first, header.count);
+
+    // Verifies every reference along with the checksum, so that casting never strays out of the nodes.
+    // Children always come after their parent, which also rules out cycles, and lets the depth of every
+    // node be known before reaching it, so that trees deeper than the casts' stacks are turned down.
+    bool valid = checksumNodes(nodes) == header.checksum;
+    std::vector<uint8_t> depths(nodes.size(), 0);
+    bool deep = false;
+    for (size_t i = 0; valid && i < nodes.size(); i++) {
+        if (nodes[i] & FLAT_LEAF) {
+            valid = (nodes[i] & ~FLAT_LEAF) < header.palette;
+        }
+        else {
+            valid = i < nodes[i] && (size_t)nodes[i] + 4 <= nodes.size();
+            for (size_t j = nodes[i]; valid && j < (size_t)nodes[i] + 4; j++) {
+                depths[j] = std::max<uint8_t>(depths[j], depths[i] + 1);
+            }
+            deep |= depths[i] >= MAX_CAST_DEPTH;
+        }
+    }
+    if (!valid) {
+        std::cerr << "Grid tree `" << file_name << "` is corrupted!\n";
+        return false;
+    }
+    if (deep) {
+        std::cerr << "Grid tree `" << file_name << "` is deeper than " << MAX_CAST_DEPTH
+                  << " levels!\n";
+        return false;
+    }
+
+    this->nodes = nodes;
+    this->storage = std::move(file);
+    this->ropes.reset();
+    this->sharing = sharesBlocks(nodes);
+    this->width = header.width;
+    this->height = header.height;
+    return true;
+}
+
+bool FlatGridTree::save(const std::string& file_name) const {
+    std::ofstream fstr(file_name, std::ios::binary);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to write grid tree file `" << file_name << "`!\n";
+        return false;
+    }
+
+    FlatGridFileHeader header = {
+        .magic = FLAT_FILE_MAGIC,
+        .version = FLAT_FILE_VERSION,
+        .palette = sizeof(GRID_PALETTE) / sizeof(GRID_PALETTE[0]),
+        .width = (uint32_t)this->width,
+        .height = (uint32_t)this->height,
+        .count = (uint32_t)this->nodes.size(),
+        .checksum = checksumNodes(this->nodes),
+    };
+    fstr.write((const char*)&header, sizeof(header));
+    fstr.write((const char*)this->nodes.data(), this->bytes());
+
+    return fstr.good();
+}
+
+bool FlatGridTree::saveHeader(const std::string& file_name, const std::string& name,
+                              const std::string& source) const {
+    std::ofstream fstr(file_name);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to write header `" << file_name << "`!\n";
+        return false;
+    }
+
+    // Escapes the source path into a string literal
+    std::string literal;
+    for (char c : source) {
+        if (c == '\\' || c == '"') {
+            literal += '\\';
+        }
+        literal += c;
+    }
+
+    fstr << "// Generated by quadcaster-convert from `" << source << "`, not to be edited\n"
+         << "#pragma once\n\n"
+         << "#include \"static_grid_tree.hpp\"\n\n\n"
+         << "inline constexpr FlatGridNode " << name << "_NODES[] = {";
+
+    // Lays out eight nodes per line
+    char word[16];
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        std::snprintf(word, sizeof(word), "0x%08X,", this->nodes[i]);
+        fstr << (i % 8 ? " " : "\n    ") << word;
+    }
+
+    size_t depth = this->stats().depths.size() - 1;
+    fstr << "\n};\n\n"
+         << "inline constexpr StaticGridTree<" << depth << "> " << name << " = {" << name << "_NODES, "
+         << this->width << ", " << this->height << "};\n\n"
+         << "// Map the tree was made from\n"
+         << "inline constexpr char " << name << "_SOURCE[] = \"" << literal << "\";\n";
+
+    return fstr.good();
+}
+
+size_t FlatGridTree::size() const {
+    return this->nodes.size();
+}
+
+size_t FlatGridTree::bytes() const {
+    return this->nodes.size_bytes();
+}
+
+bool FlatGridTree::empty() const {
+    return this->nodes[0] == FLAT_LEAF;
+}
+
+bool FlatGridTree::shared() const {
+    return this->sharing;
+}
+
+bool FlatGridTree::rope() {
+    if (this->sharing) {
+        std::cerr << "Grid trees sharing subtrees can't be roped!\n";
+        return false;
+    }
+
+    auto built = std::make_shared<std::vector<FlatRopes>>(this->nodes.size());
+    RopeNeighbor bounds[4];
+    ropeSubgrid(this->nodes, *built, 0, 0, bounds);
+    this->ropes = std::move(built);
+    return true;
+}
+
+bool FlatGridTree::roped() const {
+    return this->ropes != nullptr;
+}
+
+size_t FlatGridTree::ropeBytes() const {
+    return this->ropes ? this->ropes->size() * sizeof(FlatRopes) : 0;
+}
+
+RayHit FlatGridTree::cast(SDL_FPoint origin, float angle, CastEngine engine) const {
+    COUNT_CAST_RAYS(1);
+    SDL_FPoint direction = {std::sin(angle), std::cos(angle)};
+    if (engine == CastEngine::Roped && this->ropes) {
+        return this->castRoped(origin, direction);
+    }
+
+    Cursor root = {this->nodes.data(), this->nodes[0]};
+    if (engine == CastEngine::Exact) {
+        return castExact(root, origin, direction);
+    }
+    if (engine != CastEngine::Recursive) {
+        return castParametric(root, origin, direction);
+    }
+
+    return castSubgrid(root, origin, angle);
+}
+
+void FlatGridTree::castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                             CastEngine engine) const {
+    if (engine == CastEngine::Roped && this->ropes) {
+        size_t count = std::min(angles.size(), out.size());
+        COUNT_CAST_RAYS(count);
+        for (size_t i = 0; i < count; i++) {
+            out[i] = this->castRoped(origin, SDL_FPoint{std::sin(angles[i]), std::cos(angles[i])});
+        }
+        return;
+    }
+
+    ::castBatch(Cursor{this->nodes.data(), this->nodes[0]}, origin, angles, out, engine);
+}
+
+void FlatGridTree::traceBeam(SDL_FPoint origin, float angle, float fov, int columns,
+                             BeamTracer& tracer) const {
+    ::traceBeam(Cursor{this->nodes.data(), this->nodes[0]}, origin, angle, fov, columns, tracer);
+}
+
+bool FlatGridTree::solidAt(SDL_FPoint point) const {
+    return querySolidAt(Cursor{this->nodes.data(), this->nodes[0]}, point);
+}
+
+bool FlatGridTree::overlapsBox(QueryBox box) const {
+    return queryOverlapsBox(Cursor{this->nodes.data(), this->nodes[0]}, box);
+}
+
+bool FlatGridTree::overlapsCircle(SDL_FPoint center, float radius) const {
+    return queryOverlapsCircle(Cursor{this->nodes.data(), this->nodes[0]}, center, radius);
+}
+
+bool FlatGridTree::overlapsTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) const {
+    return queryOverlapsTriangle(Cursor{this->nodes.data(), this->nodes[0]}, a, b, c);
+}
+
+SolidHit FlatGridTree::nearestSolid(SDL_FPoint point, float radius) const {
+    return queryNearestSolid(Cursor{this->nodes.data(), this->nodes[0]}, point, radius);
+}
+
+void FlatGridTree::solidAtBatch(std::span<const SDL_FPoint> points, std::span<uint8_t> out,
+                                ThreadPool* pool) const {
+    queryBatch(points, out, pool, [&](SDL_FPoint point) { return (uint8_t)this->solidAt(point); });
+}
+
+void FlatGridTree::overlapsBoxBatch(std::span<const QueryBox> boxes, std::span<uint8_t> out,
+                                    ThreadPool* pool) const {
+    queryBatch(boxes, out, pool, [&](QueryBox box) { return (uint8_t)this->overlapsBox(box); });
+}
+
+void FlatGridTree::overlapsCircleBatch(std::span<const SDL_FPoint> centers, float radius,
+                                       std::span<uint8_t> out, ThreadPool* pool) const {
+    queryBatch(centers, out, pool,
+               [&](SDL_FPoint center) { return (uint8_t)this->overlapsCircle(center, radius); });
+}
+
+void FlatGridTree::nearestSolidBatch(std::span<const SDL_FPoint> points, float radius,
+                                     std::span<SolidHit> out, ThreadPool* pool) const {
+    queryBatch(points, out, pool, [&](SDL_FPoint point) { return this->nearestSolid(point, radius); });
+}
+
+RayHit FlatGridTree::castSegment(SDL_FPoint from, SDL_FPoint to) const {
+    return ::castSegment(Cursor{this->nodes.data(), this->nodes[0]}, from, to);
+}
+
+bool FlatGridTree::lineOfSight(SDL_FPoint from, SDL_FPoint to) const {
+    return !this->castSegment(from, to).hit;
+}
+
+void FlatGridTree::lineOfSight(std::span<const SightPair> pairs, std::span<uint8_t> out,
+                               ThreadPool* pool) const {
+    queryLineOfSight(Cursor{this->nodes.data(), this->nodes[0]}, pairs, out, pool);
+}
+
+void FlatGridTree::lineOfSight(std::span<const SDL_FPoint> viewers, std::span<const SDL_FPoint> targets,
+                               std::span<uint8_t> out, ThreadPool* pool) const {
+    queryLineOfSight(Cursor{this->nodes.data(), this->nodes[0]}, viewers, targets, out, pool);
+}
+
+RayHit FlatGridTree::castRoped(SDL_FPoint origin, SDL_FPoint direction) const {
+    const std::vector<FlatRopes>& ropes = *this->ropes;
+    float dx = direction.x;
+    float dy = direction.y;
+    float inv_dx = 1.0f / dx;
+    float inv_dy = 1.0f / dy;
+
+    float t_enter = 0.0f;
+    float t_exit = INF;
+    if (!clipToGrid(origin, direction, SDL_FPoint{inv_dx, inv_dy}, t_enter, t_exit)) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+
+    // Locus on entry, clamped onto the grid against rounding
+    float t = t_enter;
+    float x = std::clamp(origin.x + t * dx, -1.0f, 1.0f);
+    float y = std::clamp(origin.y + t * dy, -1.0f, 1.0f);
+
+    // Node along with its bounds, starting off at the root
+    uint32_t index = 0;
+    float x_mid = 0.0f, y_mid = 0.0f, half = 1.0f;
+
+    // Center of the node of the given half size containing a smaller one centered at `mid`
+    auto enclosing = [](float mid, float half) {
+        float side = 2.0f * half;
+        return (std::floor((mid + 1.0f) / side) + 0.5f) * side - 1.0f;
+    };
+
+    while (true) {
+        // Descends into the quadrants containing the locus until reaching a leaf
+        FlatGridNode node = this->nodes[index];
+        while (!(node & FLAT_LEAF)) {
+            bool x_pos = x > x_mid || (x == x_mid && dx >= 0.0f);
+            bool y_pos = y > y_mid || (y == y_mid && dy >= 0.0f);
+
+            half /= 2.0f;
+            x_mid += x_pos ? half : -half;
+            y_mid += y_pos ? half : -half;
+            index = node + mapQuadrantIndex(x_pos, y_pos);
+            node = this->nodes[index];
+            COUNT_CAST_NODE();
+            COUNT_CAST_EMPTY(node == FLAT_LEAF);
+        }
+        COUNT_CAST_DEPTH(ropes[index].depth);
+
+        // Confirms ray hit success upon reaching a leaf which isn't empty
+        if (node != FLAT_LEAF) {
+            float local_x = (x - x_mid) / half;
+            float local_y = (y - y_mid) / half;
+            return RayHit{.hit = true,
+                          .locus = SDL_FPoint{x, y},
+                          .color = shadeLeaf(GRID_PALETTE[node & ~FLAT_LEAF], local_x, local_y),
+                          .face = leafFace(local_x, local_y),
+                          .leaf = SDL_FPoint{x_mid, y_mid}};
+        }
+
+        // Steps through the slabs of the empty quadrant as `castParametric` does
+        float x_bound = x_mid + (dx >= 0.0f ? half : -half);
+        float y_bound = y_mid + (dy >= 0.0f ? half : -half);
+        float t_x = dx != 0.0f ? (x_bound - origin.x) * inv_dx : INF;
+        float t_y = dy != 0.0f ? (y_bound - origin.y) * inv_dy : INF;
+
+        t = std::max(t, std::min(t_x, t_y));
+        if (t >= t_exit) {
+            t = t_exit;
+            break;
+        }
+
+        if (t_x <= t_y) {
+            x = x_bound;
+            y = std::clamp(origin.y + t * dy, y_mid - half, y_mid + half);
+        }
+        if (t_y <= t_x) {
+            x = t_x == t_y ? x_bound : std::clamp(origin.x + t * dx, x_mid - half, x_mid + half);
+            y = y_bound;
+        }
+
+        // Follows the ropes of the faces crossed until reaching a node containing the locus
+        while (true) {
+            bool within_x = withinLeaning(x, dx, x_mid - half, x_mid + half);
+            bool within_y = withinLeaning(y, dy, y_mid - half, y_mid + half);
+            if (within_x && within_y) {
+                break;
+            }
+
+            RopeFace face = !within_x ? (x > x_mid ? ROPE_X_POS : ROPE_X_NEG)
+                                      : (y > y_mid ? ROPE_Y_POS : ROPE_Y_NEG);
+            uint32_t next = ropes[index].faces[face];
+            if (next == FLAT_NO_ROPE) {
+                return RayHit{.hit = false, .locus = SDL_FPoint{origin.x + t * dx, origin.y + t * dy}};
+            }
+
+            // Neighbors are at least as large, lined up with this node along the face
+            float next_half = std::ldexp(1.0f, -(int)ropes[next].depth);
+            if (!within_x) {
+                x_mid += face == ROPE_X_POS ? half + next_half : -half - next_half;
+                y_mid = enclosing(y_mid, next_half);
+            }
+            else {
+                x_mid = enclosing(x_mid, next_half);
+                y_mid += face == ROPE_Y_POS ? half + next_half : -half - next_half;
+            }
+            half = next_half;
+            index = next;
+            COUNT_CAST_NODE();
+            COUNT_CAST_EMPTY(this->nodes[next] == FLAT_LEAF);
+        }
+    }
+
+    // Exits the grid tree without hitting anything
+    return RayHit{.hit = false, .locus = SDL_FPoint{origin.x + t * dx, origin.y + t * dy}};
+}
+
+TreeStats FlatGridTree::stats() const {
+    TreeStats stats = FlatGridTree::stats(this->nodes);
+    stats.bytes = this->bytes() + this->ropeBytes();
+    return stats;
+}
+
+TreeStats FlatGridTree::stats(std::span<const FlatGridNode> nodes) {
+    // Counts every node once in index order rather than walking down from the root, so that subtrees
+    // shared by many branches aren't counted over again. Children coming after their parents, each node
+    // is counted at the deepest level any of its parents reach it from.
+    const uint8_t UNREACHED = 0xFF;
+    std::vector<uint8_t> depths(nodes.size(), UNREACHED);
+    depths[0] = 0;
+
+    TreeStats stats;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        FlatGridNode node = nodes[i];
+        if (depths[i] == UNREACHED || (i > 0 && node == FLAT_LEAF)) {
+            continue;
+        }
+
+        if (stats.depths.size() <= depths[i]) {
+            stats.depths.resize(depths[i] + 1);
+        }
+        stats.nodes++;
+        stats.depths[depths[i]]++;
+
+        if (node & FLAT_LEAF) {
+            stats.leaves += GRID_PALETTE[node & ~FLAT_LEAF].a != 0;
+            continue;
+        }
+
+        for (size_t j = node; j < (size_t)node + 4; j++) {
+            uint8_t depth = depths[i] + 1;
+            depths[j] = depths[j] == UNREACHED ? depth : std::max(depths[j], depth);
+        }
+    }
+
+    return stats;
+}
+
+std::string FlatGridTree::graphviz() const {
+    // Numbers of the nodes printed already by their index, for blocks shared by many branches to be
+    // printed only once, with an edge from each branch
+    std::vector<int> printed(this->nodes.size(), -1);
+    int i = 0;
+    return "digraph QuadTree {\n"
+           "\tnode [shape=circle, style=filled, fontname=\"Helvetica\"];\n"
+           "\n"
+           "\tnode0 [label=\"Root\", fillcolor=\"black\", fontcolor=\"white\"];\n" +
+           this->graphviz(this->nodes[0], i, printed) + "}\n";
+}
+
+std::string FlatGridTree::graphviz(FlatGridNode node, int& i, std::vector<int>& printed) const {
+    const char* names[4] = {"X+ Y+", "X- Y+", "X- Y-", "X+ Y-"};
+
+    int parent = i;
+    std::string parent_str = std::to_string(parent);
+    std::string out;
+
+    if (node & FLAT_LEAF) {
+        return out;
+    }
+
+    if (printed[node] >= 0) {
+        for (int q = 0; q < 4; q++) {
+            out += "\tnode" + parent_str + " -> node" + std::to_string(printed[node + q]) + ";\n";
+        }
+        return out;
+    }
+
+    // Children blocks are already in the printing order of `GridTree::graphviz`
+    for (int q = 0; q < 4; q++) {
+        i++;
+        printed[node + q] = i;
+        FlatGridNode quadrant = this->nodes[node + q];
+
+        std::string fill = "000000FF";
+        std::string font = "red";
+        if (quadrant != FLAT_LEAF) {
+            font = "white";
+
+            if (quadrant & FLAT_LEAF) {
+                fill = toColorHex(GRID_PALETTE[quadrant & ~FLAT_LEAF]);
+                font = "black";
+            }
+        }
+
+        out += "\tnode" + std::to_string(i) + " [label=\"" + names[q] + "\", fillcolor=\"#" + fill +
+               "\", fontcolor=\"" + font + "\"];\n";
+        out += "\tnode" + parent_str + " -> node" + std::to_string(i) + ";\n";
+
+        if (quadrant != FLAT_LEAF) {
+            out += this->graphviz(quadrant, i, printed);
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "frame_stats.hpp"
+
+
+// Milliseconds between two readings of the performance counter
+static double millisecondsBetween(Uint64 from, Uint64 to) {
+    return (double)(to - from) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void FrameStats::begin() {
+    this->phase_start = SDL_GetPerformanceCounter();
+    if (this->period_start == 0) {
+        this->period_start = this->phase_start;
+    }
+}
+
+void FrameStats::time(FramePhase phase) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    this->phase_ms[(int)phase] += millisecondsBetween(this->phase_start, now);
+    this->phase_start = now;
+}
+
+void FrameStats::gather(const CastStats& counts) {
+#ifdef QUADCASTER_STATS
+    std::lock_guard lock(this->mutex);
+    this->casts.merge(counts);
+#endif
+}
+
+bool FrameStats::endFrame() {
+    this->frames++;
+    double elapsed_ms = millisecondsBetween(this->period_start, SDL_GetPerformanceCounter());
+    if (elapsed_ms < this->period * 1000.0) {
+        return false;
+    }
+
+    // Averages the period, then starts over
+    this->summary.frames = this->frames;
+    this->summary.fps = this->frames * 1000.0 / elapsed_ms;
+    for (int i = 0; i < 3; i++) {
+        this->summary.phase_ms[i] = this->phase_ms[i] / this->frames;
+        this->phase_ms[i] = 0.0;
+    }
+    {
+        std::lock_guard lock(this->mutex);
+        this->summary.casts = this->casts;
+        this->casts = CastStats();
+    }
+
+    this->frames = 0;
+    this->period_start = SDL_GetPerformanceCounter();
+    return true;
+}
+
+std::string FrameStats::json(const TreeStats* tree) const {
+    const FrameSummary& summary = this->summary;
+
+    std::ostringstream json;
+    json << "{\"frames\": " << summary.frames << ", \"fps\": " << summary.fps
+         << ", \"cast_ms\": " << summary.phase_ms[(int)FramePhase::Cast]
+         << ", \"draw_ms\": " << summary.phase_ms[(int)FramePhase::Draw]
+         << ", \"present_ms\": " << summary.phase_ms[(int)FramePhase::Present];
+
+#ifdef QUADCASTER_STATS
+    double frames = std::max(summary.frames, (size_t)1);
+    json << ", \"rays_per_frame\": " << summary.casts.rays / frames
+         << ", \"nodes_per_frame\": " << summary.casts.nodes / frames
+         << ", \"empty_per_frame\": " << summary.casts.empty / frames
+         << ", \"max_depth\": " << summary.casts.depth;
+#endif
+
+    if (tree) {
+        json << ", \"tree\": {\"nodes\": " << tree->nodes << ", \"leaves\": " << tree->leaves
+             << ", \"bytes\": " << tree->bytes << ", \"depths\": [";
+        for (size_t i = 0; i < tree->depths.size(); i++) {
+            json << (i ? ", " : "") << tree->depths[i];
+        }
+        json << "]}";
+    }
+
+    json << "}";
+    return json.str();
+}
+
+void FrameStats::draw(SDL_Renderer* renderer, float x, float y, const TreeStats* tree) const {
+    const FrameSummary& summary = this->summary;
+    char lines[4][128];
+    int count = 0;
+    std::snprintf(lines[count++], sizeof(lines[0]), "%.0f FPS: cast %.2f, draw %.2f, present %.2f ms",
+                  summary.fps, summary.phase_ms[(int)FramePhase::Cast],
+                  summary.phase_ms[(int)FramePhase::Draw], summary.phase_ms[(int)FramePhase::Present]);
+#ifdef QUADCASTER_STATS
+    double frames = std::max(summary.frames, (size_t)1);
+    double rays = std::max(summary.casts.rays, (size_t)1);
+    std::snprintf(lines[count++], sizeof(lines[0]), "%.0f rays, %.1f nodes (%.1f empty) per ray",
+                  summary.casts.rays / frames, summary.casts.nodes / rays, summary.casts.empty / rays);
+    std::snprintf(lines[count++], sizeof(lines[0]), "Deepest level stepped into: %zu",
+                  summary.casts.depth);
+#else
+    std::snprintf(lines[count++], sizeof(lines[0]), "Traversal counters compiled out");
+#endif
+    if (tree) {
+        std::snprintf(lines[count++], sizeof(lines[0]), "Tree: %zu nodes, %zu solid, %.2f MB",
+                      tree->nodes, tree->leaves, tree->bytes / 1048576.0);
+    }
+
+    // Histogram of the nodes per depth, scaled to the most populated one
+    const float CHARACTER = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+    const float LINE = CHARACTER + 4.0f;
+    const float BAR_WIDTH = 6.0f;
+    const float BAR_HEIGHT = 40.0f;
+    size_t most = 0;
+    if (tree) {
+        for (size_t nodes : tree->depths) {
+            most = std::max(most, nodes);
+        }
+    }
+
+    // Darkens the panel behind, keeping it readable over any wall
+    size_t longest = 0;
+    for (int i = 0; i < count; i++) {
+        longest = std::max(longest, std::strlen(lines[i]));
+    }
+    float histogram = most ? BAR_HEIGHT + 4.0f : 0.0f;
+    SDL_FRect panel = {x - 4.0f, y - 4.0f, longest * CHARACTER + 8.0f, count * LINE + histogram + 4.0f};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    for (int i = 0; i < count; i++) {
+        SDL_RenderDebugText(renderer, x, y + i * LINE, lines[i]);
+    }
+
+    if (most) {
+        float bottom = y + count * LINE + BAR_HEIGHT;
+        for (size_t depth = 0; depth < tree->depths.size(); depth++) {
+            float height = std::max(BAR_HEIGHT * tree->depths[depth] / most, 1.0f);
+            SDL_FRect bar = {x + depth * (BAR_WIDTH + 2.0f), bottom - height, BAR_WIDTH, height};
+            SDL_RenderFillRect(renderer, &bar);
+        }
+    }
+}
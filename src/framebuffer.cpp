@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "framebuffer.hpp"
+
+
+void Framebuffer::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+
+    this->tops.assign(width, 0);
+    this->bottoms.assign(width, 0);
+    this->colors.assign(width, 0);
+}
+
+void Framebuffer::setColumn(int x, float top, float bottom, SDL_Color color) {
+    // Covers the rows whose centers lie within the wall, as `SDL_RenderLine` would
+    this->tops[x] = (int32_t)std::clamp(std::ceil(top - 0.5f), 0.0f, (float)this->height);
+    this->bottoms[x] = (int32_t)std::clamp(std::floor(bottom - 0.5f) + 1.0f, 0.0f, (float)this->height);
+    this->colors[x] = packXRGB(color);
+}
+
+void Framebuffer::clearColumn(int x) {
+    this->tops[x] = 0;
+    this->bottoms[x] = 0;
+}
+
+void Framebuffer::render(uint32_t* pixels, int pitch, SDL_Color sky, SDL_Color ground, int y_start,
+                         int y_end) const {
+    for (int y = y_start; y < y_end; y++) {
+        uint32_t* row = (uint32_t*)((uint8_t*)pixels + (size_t)y * pitch);
+
+        // Sky above the midpoint, and ground below it
+        uint32_t backdrop = packXRGB(2 * y + 1 < this->height ? sky : ground);
+
+        int x = 0;
+#if defined(__SSE2__)
+        // Selects between the wall and the backdrop four pixels at a time
+        __m128i row_y = _mm_set1_epi32(y);
+        __m128i fill = _mm_set1_epi32(backdrop);
+        for (; x + 4 <= this->width; x += 4) {
+            __m128i top = _mm_loadu_si128((const __m128i*)&this->tops[x]);
+            __m128i bottom = _mm_loadu_si128((const __m128i*)&this->bottoms[x]);
+            __m128i color = _mm_loadu_si128((const __m128i*)&this->colors[x]);
+
+            // top <= y && y < bottom
+            __m128i below_top = _mm_cmpgt_epi32(top, row_y);
+            __m128i wall = _mm_andnot_si128(below_top, _mm_cmplt_epi32(row_y, bottom));
+            __m128i pixel = _mm_or_si128(_mm_and_si128(wall, color), _mm_andnot_si128(wall, fill));
+            _mm_storeu_si128((__m128i*)&row[x], pixel);
+        }
+#endif
+
+        // Remaining pixels which don't fill a whole vector
+        for (; x < this->width; x++) {
+            bool wall = this->tops[x] <= y && y < this->bottoms[x];
+            row[x] = wall ? this->colors[x] : backdrop;
+        }
+    }
+}
@@ -1,123 +1,227 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <utility>
 
 #include "grid_map.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 
+GridMap::GridMap(size_t width, size_t height) : width(width), height(height) {
+    // Fills every row with empty blocks
+    this->stride = (width + 1) / 2;
+    this->cells.assign(height * this->stride, 0);
+}
+
 GridMap::GridMap(const std::string& file_name) {
-    // Loads file
-    std::ifstream fstr(file_name);
-    if (!fstr.is_open()) {
-        std::cerr << "Failed to open map file `" << file_name << "`!\n";
+    // Loads file, where an empty one is an empty map
+    MappedFile file(file_name);
+    if (!file.isOpen()) {
         return;
     }
 
-    // Reads per line in the file
-    std::string line;
-    while (std::getline(fstr, line)) {
+    const char* begin = (const char*)file.data();
+    const char* end = begin + file.size();
+
+    // Measures every line first, so that the blocks are allocated at once
+    for (const char* line = begin; line < end; this->height++) {
+        const char* newline = (const char*)std::memchr(line, '\n', end - line);
+        const char* line_end = newline ? newline : end;
+
         // Updates width to the maximum line length
-        if (line.size() > this->width) {
-            this->width = line.size();
+        this->width = std::max(this->width, (size_t)(line_end - line));
+        line = line_end + 1;
+    }
+
+    this->stride = (this->width + 1) / 2;
+    this->cells.assign(this->height * this->stride, 0);
+
+    // Maps decimal numbers, assuming zero if an unrecognized character is found
+    auto digit = [](char c) -> uint8_t {
+        uint8_t n = c - '0';
+        return n <= 9 ? n : 0;
+    };
+
+    // Packs every line into its row, a pair of characters at a time
+    uint8_t* row = this->cells.data();
+    for (const char* line = begin; line < end; row += this->stride) {
+        const char* newline = (const char*)std::memchr(line, '\n', end - line);
+        size_t length = (newline ? newline : end) - line;
+
+        size_t x = 0;
+        for (; x + 2 <= length; x += 2) {
+            row[x / 2] = digit(line[x]) | digit(line[x + 1]) << 4;
+        }
+        if (x < length) {
+            row[x / 2] = digit(line[x]);
         }
 
-        this->map.push_back({});
-        this->map.back().reserve(line.size());
-
-        // Reads per character in the line
-        for (char c : line) {
-            // Maps decimal numbers
-            if ('0' <= c && c <= '9') {
-                this->map.back().push_back(c - '0');
-            }
-            // Assumes zero if an unrecognized character is found
-            else {
-                this->map.back().push_back(0);
-            }
+        line += length + 1;
+    }
+}
+
+bool GridMap::save(const std::string& file_name) const {
+    std::ofstream fstr(file_name);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to write map file `" << file_name << "`!\n";
+        return false;
+    }
+
+    // Writes a line of decimal digits per row
+    std::string line;
+    for (size_t y = 0; y < this->height; y++) {
+        line.resize(this->width);
+        for (size_t x = 0; x < this->width; x++) {
+            line[x] = '0' + this->getAt(x, y);
         }
+        fstr << line << '\n';
     }
 
-    this->height = this->map.size();
+    return fstr.good();
 }
 
 uint8_t GridMap::getAt(size_t x, size_t y) const {
-    if (y >= this->map.size()) {
+    // Rows are padded, so that anything beyond the width or height is empty
+    if (x >= this->width || y >= this->height) {
         return 0;
     }
 
-    if (x >= this->map[y].size()) {
-        return 0;
-    }
-
-    return this->map[y][x];
+    return this->cells[y * this->stride + x / 2] >> (x % 2 * 4) & 0x0F;
 }
 
 void GridMap::setAt(size_t x, size_t y, uint8_t type) {
-    // In case it attempts to set out of the current rows
-    this->map.reserve(y + 1);
-    while (y >= this->map.size()) {
-        this->map.push_back({}); // Filler
+    // In case it attempts to set out of the current columns, widens every row at least twofold
+    if (x / 2 >= this->stride) {
+        size_t stride = std::max(x / 2 + 1, this->stride * 2);
+        std::vector<uint8_t> cells(this->height * stride, 0);
+        for (size_t row = 0; row < this->height; row++) {
+            std::memcpy(&cells[row * stride], &this->cells[row * this->stride], this->stride);
+        }
+
+        this->cells = std::move(cells);
+        this->stride = stride;
     }
 
-    // In case it attempts to set out of the current column of the row
-    this->map[y].reserve(x + 1);
-    while (x >= this->map[y].size()) {
-        this->map[y].push_back(0); // Filler
+    // In case it attempts to set out of the current rows
+    if (y >= this->height) {
+        this->cells.resize((y + 1) * this->stride, 0); // Filler
+        this->height = y + 1;
     }
 
     // The actual assignment
-    this->map[y][x] = type;
+    uint8_t& cell = this->cells[y * this->stride + x / 2];
+    cell = x % 2 ? (cell & 0x0F) | type << 4 : (cell & 0xF0) | (type & 0x0F);
+
+    // Updates width upon any prior size readjustments
+    this->width = x + 1 > width ? x + 1 : width;
+}
+
+static GridTree combineQuadrants(GridTree (&quadrants)[4]) {
+    // Homogeneous subgrids collapse into a leaf before anything is allocated, as `prune()` would do
+    bool homogeneous = true;
+    for (int i = 0; i < 4; i++) {
+        const SDL_Color& a = quadrants[i].color;
+        const SDL_Color& b = quadrants[0].color;
+        if (!quadrants[i].isLeaf() || a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a) {
+            homogeneous = false;
+            break;
+        }
+    }
+    if (homogeneous) {
+        return GridTree(quadrants[0].color);
+    }
+
+    // Otherwise only moves in the quadrants that aren't empty leaves
+    GridTree tree;
+    for (int i = 0; i < 4; i++) {
+        if (!quadrants[i].isLeaf() || quadrants[i].color.a != 0) {
+            tree.setQuadrant(i == 0 || i == 3, i <= 1, std::move(quadrants[i]));
+        }
+    }
 
-    // Updates width and height upon any prior size readjustments
-    this->height = this->map.size();
-    this->width = x > width ? x : width;
+    return tree;
 }
 
 GridTree GridMap::treeify() const {
     size_t max_size = nextPowerOfTwo(this->width > this->height ? width : height);
-    GridTree root;
-
-    subtreeify(root, 0, 0, max_size);
-    return root;
+    return this->subtreeify(0, 0, max_size);
 }
 
-void GridMap::subtreeify(GridTree& tree, size_t x_start, size_t y_start, size_t size) const {
-    // Instantiates a leaf, as it corresponds to a single block in the grid
-    if (size == 1) {
-        tree.color = GRID_PALETTE[this->getAt(x_start, y_start)];
-        return;
+GridTree GridMap::treeify(ThreadPool& pool) const {
+    size_t max_size = nextPowerOfTwo(this->width > this->height ? width : height);
+
+    // Splits the top levels into independent subgrids, several per thread to even out their costs,
+    // though without going below subgrids cheaper to build than to schedule
+    size_t split = 1;
+    while (split * split < 8 * (pool.size() + 1) && max_size / split > 64) {
+        split *= 2;
     }
+    if (split == 1) {
+        return this->treeify();
+    }
+
+    // Builds every subgrid on whichever thread takes it, allocating its nodes there
+    size_t size = max_size / split;
+    std::vector<GridTree> subtrees(split * split);
+    pool.parallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            subtrees[i] = this->subtreeify(i % split * size, i / split * size, size);
+        }
+    });
 
-    // Fills the quadrants with subgrids for later assignments
-    for (int i = 0b00; i <= 0b11; i++) {
-        tree.setQuadrant(i & 0b01, i & 0b10, GridTree());
+    // Stitches the subtrees together the same way as the serial build
+    return this->assemble(subtrees, split, size, 0, 0, max_size);
+}
+
+GridTree GridMap::assemble(std::vector<GridTree>& subtrees, size_t split, size_t subtree_size,
+                           size_t x_start, size_t y_start, size_t size) const {
+    if (x_start >= this->width || y_start >= this->height) {
+        return GridTree();
     }
 
-#define REMOVE_IF_NULL(X, Y)                      \
-    {                                             \
-        auto& quad = tree.getQuadrant(X, Y);      \
-        if (quad.isLeaf() && quad.color.a == 0) { \
-            tree.clearQuadrant(X, Y);             \
-        }                                         \
+    // Takes the subtree built in parallel upon reaching the level they were split at
+    if (size == subtree_size) {
+        return std::move(subtrees[y_start / size * split + x_start / size]);
     }
 
-    // Quadrant X- Y-
-    this->subtreeify(tree.getQuadrant(false, false), x_start, y_start + size / 2, size / 2);
-    REMOVE_IF_NULL(false, false);
+    size_t half = size / 2;
+    GridTree quadrants[4] = {
+        this->assemble(subtrees, split, subtree_size, x_start + half, y_start, half),        // X+ Y+
+        this->assemble(subtrees, split, subtree_size, x_start, y_start, half),               // X- Y+
+        this->assemble(subtrees, split, subtree_size, x_start, y_start + half, half),        // X- Y-
+        this->assemble(subtrees, split, subtree_size, x_start + half, y_start + half, half), // X+ Y-
+    };
 
-    // Quadrant X- Y+
-    this->subtreeify(tree.getQuadrant(false, true), x_start, y_start, size / 2);
-    REMOVE_IF_NULL(false, true);
+    return combineQuadrants(quadrants);
+}
 
-    // Quadrant X+ Y-
-    this->subtreeify(tree.getQuadrant(true, false), x_start + size / 2, y_start + size / 2, size / 2);
-    REMOVE_IF_NULL(true, false);
+GridTree GridMap::treeify(size_t x_start, size_t y_start, size_t size) const {
+    // Treeifies only the square of blocks, as a tile of a larger world
+    return this->subtreeify(x_start, y_start, nextPowerOfTwo(size));
+}
+
+GridTree GridMap::subtreeify(size_t x_start, size_t y_start, size_t size) const {
+    // Skips subgrids lying entirely outside of the map, as they're empty
+    if (x_start >= this->width || y_start >= this->height) {
+        return GridTree();
+    }
+
+    // Instantiates a leaf, as it corresponds to a single block in the grid
+    if (size == 1) {
+        return GridTree(GRID_PALETTE[this->getAt(x_start, y_start)]);
+    }
 
-    // Quadrant X+ Y+
-    this->subtreeify(tree.getQuadrant(true, true), x_start + size / 2, y_start, size / 2);
-    REMOVE_IF_NULL(true, true);
+    // Builds the quadrants bottom-up, in the order of `mapQuadrantIndex`
+    size_t half = size / 2;
+    GridTree quadrants[4] = {
+        this->subtreeify(x_start + half, y_start, half),        // X+ Y+
+        this->subtreeify(x_start, y_start, half),               // X- Y+
+        this->subtreeify(x_start, y_start + half, half),        // X- Y-
+        this->subtreeify(x_start + half, y_start + half, half), // X+ Y-
+    };
 
-    // Prunes homogeneous subgrids
-    tree.prune();
+    return combineQuadrants(quadrants);
 }
@@ -1,10 +1,39 @@
+#include <algorithm>
+#include <utility>
+
 #include "grid_tree.hpp"
+#include "beam_tracer.hpp"
+#include "grid_cast.hpp"
+#include "grid_query.hpp"
 #include "utils.hpp"
 
 
+struct GridTree::Cursor {
+    const GridTree* node = nullptr;
+
+    bool isLeaf() const {
+        return this->node->isLeaf();
+    }
+
+    SDL_Color color() const {
+        return this->node->color;
+    }
+
+    bool quadrant(size_t index, Cursor& out) const {
+        out.node = this->node->quadrants[index];
+        return out.node;
+    }
+
+    float clearance(size_t index) const {
+        return this->node->gaps[index] / 256.0f;
+    }
+};
+
+
 GridTree::GridTree(const GridTree& orig) {
     this->color = orig.color;
     for (int i = 0; i < 4; i++) {
+        this->gaps[i] = orig.gaps[i];
         if (orig.quadrants[i]) {
             this->quadrants[i] = new GridTree(*orig.quadrants[i]);
         }
@@ -14,6 +43,7 @@ GridTree::GridTree(const GridTree& orig) {
 GridTree::GridTree(GridTree&& orig) {
     this->color = orig.color;
     for (int i = 0; i < 4; i++) {
+        this->gaps[i] = orig.gaps[i];
         this->quadrants[i] = orig.quadrants[i];
         orig.quadrants[i] = nullptr;
     }
@@ -23,6 +53,7 @@ GridTree& GridTree::operator=(GridTree&& orig) {
     if (this != &orig) {
         this->color = orig.color;
         for (int i = 0; i < 4; ++i) {
+            this->gaps[i] = orig.gaps[i];
             delete this->quadrants[i];
             this->quadrants[i] = orig.quadrants[i];
             orig.quadrants[i] = nullptr;
@@ -42,10 +73,24 @@ void GridTree::setQuadrant(bool xPos, bool yPos, const GridTree& tree) {
     size_t index = mapQuadrantIndex(xPos, yPos);
     GridTree* old = this->quadrants[index];
     this->quadrants[index] = new GridTree(tree);
+    this->gaps[index] = 0;
 
     if (old) {
         delete old;
     }
+    this->represent();
+}
+
+void GridTree::setQuadrant(bool xPos, bool yPos, GridTree&& tree) {
+    size_t index = mapQuadrantIndex(xPos, yPos);
+    GridTree* old = this->quadrants[index];
+    this->quadrants[index] = new GridTree(std::move(tree));
+    this->gaps[index] = 0;
+
+    if (old) {
+        delete old;
+    }
+    this->represent();
 }
 
 void GridTree::clearQuadrant(bool xPos, bool yPos) {
@@ -53,6 +98,13 @@ void GridTree::clearQuadrant(bool xPos, bool yPos) {
     if (this->quadrants[index]) {
         delete this->quadrants[index];
         this->quadrants[index] = nullptr;
+        this->gaps[index] = 0;
+
+        // Turns into an empty leaf once its last quadrant is gone
+        if (this->isLeaf()) {
+            this->color = SDL_Color{0, 0, 0, 0};
+        }
+        this->represent();
     }
 }
 
@@ -73,10 +125,48 @@ bool GridTree::isLeaf() const {
     return true;
 }
 
+size_t GridTree::count() const {
+    // Counts itself along with every node in its quadrants
+    size_t nodes = 1;
+    for (int i = 0; i < 4; i++) {
+        if (this->quadrants[i]) {
+            nodes += this->quadrants[i]->count();
+        }
+    }
+    return nodes;
+}
+
+void GridTree::represent() {
+    if (this->isLeaf()) {
+        return;
+    }
+
+    // Weighs the color of every quadrant by how much of it is solid, absent ones counting as empty
+    uint32_t r = 0, g = 0, b = 0, a = 0;
+    for (int i = 0; i < 4; i++) {
+        if (this->quadrants[i]) {
+            const SDL_Color& c = this->quadrants[i]->color;
+            r += c.r * c.a;
+            g += c.g * c.a;
+            b += c.b * c.a;
+            a += c.a;
+        }
+    }
+
+    // Rounds coverage up, so that branches with anything solid below never come out as transparent
+    if (a == 0) {
+        this->color = SDL_Color{0, 0, 0, 0};
+        return;
+    }
+    this->color = SDL_Color{(uint8_t)(r / a), (uint8_t)(g / a), (uint8_t)(b / a),
+                            (uint8_t)((a + 3) / 4)};
+}
+
 void GridTree::prune() {
     // Ensures that every quadrant exists and is a leaf
     for (int i = 0; i < 4; i++) {
         if (!this->quadrants[i] || !this->quadrants[i]->isLeaf()) {
+            this->represent();
             return;
         }
     }
@@ -86,6 +176,7 @@ void GridTree::prune() {
     for (int i = 1; i < 4; i++) {
         if (this->quadrants[i]->color.r != color.r || this->quadrants[i]->color.g != color.g ||
             this->quadrants[i]->color.b != color.b || this->quadrants[i]->color.a != color.a) {
+            this->represent();
             return;
         }
     }
@@ -99,173 +190,232 @@ void GridTree::prune() {
     this->color = color;
 }
 
+size_t GridTree::setCell(size_t size, size_t x, size_t y, SDL_Color color, bool clearance) {
+    return this->setRect(size, x, y, 1, 1, color, clearance);
+}
 
-RayHit GridTree::cast(SDL_FPoint origin, float angle) const {
-    float x = origin.x;
-    float y = origin.y;
-
-    // Vector of ray angle
-    float dx = std::sin(angle);
-    float dy = std::cos(angle);
+size_t GridTree::setRect(size_t size, size_t x, size_t y, size_t width, size_t height,
+                         SDL_Color color, bool clearance) {
+    if (width == 0 || height == 0) {
+        return size;
+    }
 
-    // Performs DDA for anything exceeding the top boundary
-    if (y > 1.0) {
-        float d = (1.0 - y) / dy;
-        if (dy == 0.0 || d < 0.0) {
-            return RayHit{.hit = false, .locus = origin};
+    // Grows the root until it spans the blocks, keeping the old one at the X- Y+ corner
+    while (x + width > size || y + height > size) {
+        if (!this->isLeaf() || this->color.a != 0) {
+            GridTree old = std::move(*this);
+            *this = GridTree();
+            this->setQuadrant(false, true, std::move(old));
         }
+        size *= 2;
+    }
+
+    this->setSubgrid(0, 0, size, x, y, width, height, color);
 
-        x += d * dx;
-        y = 1.0;
+    // Measures the empty quadrants around the blocks again, lest they skip rays into the new ones
+    float scale = 2.0f / size;
+    QueryBox blocks = {{x * scale - 1.0f, 1.0f - (y + height) * scale},
+                       {(x + width) * scale - 1.0f, 1.0f - y * scale}};
+    this->measureGaps(*this, 0.0f, 0.0f, 1.0f, blocks, clearance);
+    return size;
+}
+
+void GridTree::measureClearance() {
+    this->measureGaps(*this, 0.0f, 0.0f, 1.0f, QueryBox{{-1.0f, -1.0f}, {1.0f, 1.0f}}, true);
+}
+
+void GridTree::setSubgrid(size_t x_start, size_t y_start, size_t size, size_t x, size_t y,
+                          size_t width, size_t height, SDL_Color color) {
+    // Skips subgrids lying entirely outside of the written blocks
+    if (x + width <= x_start || x_start + size <= x || y + height <= y_start || y_start + size <= y) {
+        return;
     }
 
-    // Performs DDA for anything exceeding the right boundary
-    if (x > 1.0) {
-        float d = (1.0 - x) / dx;
-        if (dx == 0.0 || d < 0.0) {
-            return RayHit{.hit = false, .locus = origin};
+    // Turns subgrids lying entirely within the written blocks into a leaf
+    if (x <= x_start && x_start + size <= x + width && y <= y_start && y_start + size <= y + height) {
+        for (int i = 0b00; i <= 0b11; i++) {
+            this->clearQuadrant(i & 0b01, i & 0b10);
         }
-
-        x = 1.0;
-        y += d * dy;
+        this->color = color;
+        return;
     }
 
-    // Performs DDA for anything exceeding the bottom boundary
-    if (y < -1.0) {
-        float d = (-1.0 - y) / dy;
-        if (dy == 0.0 || d < 0.0) {
-            return RayHit{.hit = false, .locus = origin};
+    // Splits a leaf into four of its color, as empty quadrants are absent
+    if (this->isLeaf()) {
+        const SDL_Color& c = this->color;
+        if (c.r == color.r && c.g == color.g && c.b == color.b && c.a == color.a) {
+            return;
         }
 
-        x += d * dx;
-        y = -1.0;
+        for (int i = 0; i < 4 && c.a != 0; i++) {
+            this->quadrants[i] = new GridTree(c);
+        }
+        this->color = SDL_Color{0, 0, 0, 0};
     }
 
-    // Performs DDA for anything exceeding the left boundary
-    if (x < -1.0) {
-        float d = (-1.0 - x) / dx;
-        if (dx == 0.0 || d < 0.0) {
-            return RayHit{.hit = false, .locus = origin};
+    // Writes into the quadrants, in the order of `mapQuadrantIndex`
+    size_t half = size / 2;
+    const size_t x_starts[4] = {x_start + half, x_start, x_start, x_start + half};
+    const size_t y_starts[4] = {y_start, y_start, y_start + half, y_start + half};
+    for (int i = 0; i < 4; i++) {
+        if (!this->quadrants[i]) {
+            this->quadrants[i] = new GridTree();
         }
+        this->quadrants[i]->setSubgrid(x_starts[i], y_starts[i], half, x, y, width, height, color);
 
-        x = -1.0;
-        y += d * dy;
+        // Drops quadrants left empty
+        if (this->quadrants[i]->isLeaf() && this->quadrants[i]->color.a == 0) {
+            delete this->quadrants[i];
+            this->quadrants[i] = nullptr;
+            this->gaps[i] = 0;
+        }
     }
 
-    // If it's inside a leaf tree, confirms ray hit success
+    // No quadrants at all leaves an empty leaf, rather than one of the color it represented as a branch
     if (this->isLeaf()) {
-        SDL_Color color = this->color;
+        this->color = SDL_Color{0, 0, 0, 0};
+        return;
+    }
 
-        bool isAtRight = x + y > 0 && x - y > 0;
-        bool isAtLeft = x + y < 0 && x - y < 0;
+    // Merges homogeneous quadrants back
+    this->prune();
+}
+
+void GridTree::measureGaps(const GridTree& root, float x_mid, float y_mid, float half, QueryBox near,
+                           bool all) {
+    // Skips leaves, having no quadrants to measure, and nodes too far for the open space around any of
+    // their empty quadrants to reach the box
+    if (this->isLeaf() || near.high.x < x_mid - 2.0f * half || x_mid + 2.0f * half < near.low.x ||
+        near.high.y < y_mid - 2.0f * half || y_mid + 2.0f * half < near.low.y) {
+        return;
+    }
 
-        // Ambient shading for the sides facing X+ and X-
-        if (isAtRight || isAtLeft) {
-            color.r = (uint8_t)(color.r * 0.95);
-            color.g = (uint8_t)(color.g * 0.95);
-            // Blue is left untouched for a colder color.
+    float quarter = half / 2.0f;
+    for (int i = 0b00; i <= 0b11; i++) {
+        bool x_pos = i & 0b01;
+        bool y_pos = i & 0b10;
+        size_t index = mapQuadrantIndex(x_pos, y_pos);
+        float x_quadrant = x_mid + (x_pos ? quarter : -quarter);
+        float y_quadrant = y_mid + (y_pos ? quarter : -quarter);
+        if (this->quadrants[index]) {
+            this->quadrants[index]->measureGaps(root, x_quadrant, y_quadrant, quarter, near, all);
+            continue;
+        }
+        if (!all && this->gaps[index] == 0) {
+            continue;
         }
 
-        return RayHit{.hit = true, .locus = SDL_FPoint{x, y}, .color = color};
-    }
-
-    // Loops while still being in the bounds of the grid
-    while (-1.0 <= x && x <= 1.0 && -1.0 <= y && y <= 1.0) {
-        // Defines the bounds of the current subgrid relative to the grid's coordinates
-        float x_min, x_max, y_min, y_max;
-        if (x >= 0.0) {
-            if (y >= 0.0) {
-                x_min = 0.0;
-                x_max = 1.0;
-                y_min = 0.0;
-                y_max = 1.0;
-            }
-            else {
-                x_min = 0.0;
-                x_max = 1.0;
-                y_min = -1.0;
-                y_max = 0.0;
-            }
+        // Grows the quadrant by 256ths of its side, doubling then bisecting until it reaches a block
+        auto open = [&](int gap) {
+            float grown = quarter + half * gap / 256.0f;
+            QueryBox box = {{x_quadrant - grown, y_quadrant - grown},
+                            {x_quadrant + grown, y_quadrant + grown}};
+            return !queryOverlapsBox(Cursor{&root}, box);
+        };
+        int low = 0;
+        int high = 1;
+        while (high < 256 && open(high)) {
+            low = high;
+            high *= 2;
         }
-        else {
-            if (y >= 0.0) {
-                x_min = -1.0;
-                x_max = 0.0;
-                y_min = 0.0;
-                y_max = 1.0;
-            }
-            else {
-                x_min = -1.0;
-                x_max = 0.0;
-                y_min = -1.0;
-                y_max = 0.0;
-            }
+        while (high - low > 1) {
+            int gap = (low + high) / 2;
+            (open(gap) ? low : high) = gap;
         }
 
-        // If a tree is present in the subgrid
-        if (GridTree* quadrant = this->quadrants[mapQuadrantIndex(x >= 0.0, y >= 0.0)]) {
-            // Maps the current grid coordinates to the local subgrid coordinates
-            SDL_FPoint local;
-            local.x = remap(x, x_min, x_max, -1.0, 1.0);
-            local.y = remap(y, y_min, y_max, -1.0, 1.0);
+        // Keeps a 256th of the side short of the block, so that rays skipping ahead never round into it
+        this->gaps[index] = (uint8_t)std::max(low - 1, 0);
+    }
+}
+
+RayHit GridTree::cast(SDL_FPoint origin, float angle, CastEngine engine, float footprint) const {
+    COUNT_CAST_RAYS(1);
+    if (engine == CastEngine::Exact && footprint <= 0.0f) {
+        SDL_FPoint direction = {std::sin(angle), std::cos(angle)};
+        return castExact(Cursor{this}, origin, direction);
+    }
+    if (engine != CastEngine::Recursive || footprint > 0.0f) {
+        SDL_FPoint direction = {std::sin(angle), std::cos(angle)};
+        return castParametric<Cursor>(Cursor{this}, origin, direction, INF, nullptr, footprint);
+    }
+
+    return castSubgrid(Cursor{this}, origin, angle);
+}
 
-            // Recurses into the subgrid
-            RayHit ray = quadrant->cast(local, angle);
+void GridTree::castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                         CastEngine engine, float footprint) const {
+    ::castBatch(Cursor{this}, origin, angles, out, engine, footprint);
+}
 
-            // Maps back the local subgrid coordinates to the current grid coordinates
-            x = ray.locus.x = remap(ray.locus.x, -1.0, 1.0, x_min, x_max);
-            y = ray.locus.y = remap(ray.locus.y, -1.0, 1.0, y_min, y_max);
+void GridTree::traceBeam(SDL_FPoint origin, float angle, float fov, int columns,
+                         BeamTracer& tracer) const {
+    ::traceBeam(Cursor{this}, origin, angle, fov, columns, tracer);
+}
 
-            // Finally returns upon a successful ray hit
-            if (ray.hit) {
-                return ray;
-            }
-        }
-        // If no tree is in the subgrid, projects a line shooting through the other side of the subgrid
-        else {
-            // Angles relative to (x, y) for each vertex of the empty grid
-            float top_left = std::atan2(x_min - x, y_max - y);
-            float top_right = std::atan2(x_max - x, y_max - y);
-            float bottom_left = std::atan2(x_min - x, y_min - y);
-            float bottom_right = std::atan2(x_max - x, y_min - y);
-
-            // If projecting to the top side
-            if (betweenAngle(angle, top_left, top_right)) {
-                // DDA for the perpendicular X axis
-                x += (y_max - y) / dy * dx;
-
-                // Nudges inside, ensuring it's within the bounds of the top neighbor
-                y = y_max + EPSILON;
-            }
-            // If projecting to the right side
-            else if (betweenAngle(angle, top_right, bottom_right)) {
-                // DDA for the perpendicular Y axis
-                y += (x_max - x) / dx * dy;
-
-                // Nudges inside, ensuring it's within the bounds of the right neighbor
-                x = x_max + EPSILON;
-            }
-            // If projecting to the bottom side
-            else if (betweenAngle(angle, bottom_right, bottom_left)) {
-                // DDA for the perpendicular X axis
-                x += (y_min - y) / dy * dx;
-
-                // Nudges inside, ensuring it's within the bounds of the bottom neighbor
-                y = y_min - EPSILON;
-            }
-            // If projecting to the left side
-            else if (betweenAngle(angle, bottom_left, top_left)) {
-                // DDA for the perpendicular Y axis
-                y += (x_min - x) / dx * dy;
-
-                // Nudges inside, ensuring it's within the bounds of the left neighbor
-                x = x_min - EPSILON;
-            }
-        }
-    }
+bool GridTree::solidAt(SDL_FPoint point) const {
+    return querySolidAt(Cursor{this}, point);
+}
+
+bool GridTree::overlapsBox(QueryBox box) const {
+    return queryOverlapsBox(Cursor{this}, box);
+}
+
+bool GridTree::overlapsCircle(SDL_FPoint center, float radius) const {
+    return queryOverlapsCircle(Cursor{this}, center, radius);
+}
+
+bool GridTree::overlapsTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) const {
+    return queryOverlapsTriangle(Cursor{this}, a, b, c);
+}
+
+SolidHit GridTree::nearestSolid(SDL_FPoint point, float radius) const {
+    return queryNearestSolid(Cursor{this}, point, radius);
+}
+
+void GridTree::solidAtBatch(std::span<const SDL_FPoint> points, std::span<uint8_t> out,
+                            ThreadPool* pool) const {
+    queryBatch(points, out, pool, [&](SDL_FPoint point) { return (uint8_t)this->solidAt(point); });
+}
+
+void GridTree::overlapsBoxBatch(std::span<const QueryBox> boxes, std::span<uint8_t> out,
+                                ThreadPool* pool) const {
+    queryBatch(boxes, out, pool, [&](QueryBox box) { return (uint8_t)this->overlapsBox(box); });
+}
+
+void GridTree::overlapsCircleBatch(std::span<const SDL_FPoint> centers, float radius,
+                                   std::span<uint8_t> out, ThreadPool* pool) const {
+    queryBatch(centers, out, pool,
+               [&](SDL_FPoint center) { return (uint8_t)this->overlapsCircle(center, radius); });
+}
+
+void GridTree::nearestSolidBatch(std::span<const SDL_FPoint> points, float radius,
+                                 std::span<SolidHit> out, ThreadPool* pool) const {
+    queryBatch(points, out, pool, [&](SDL_FPoint point) { return this->nearestSolid(point, radius); });
+}
+
+RayHit GridTree::castSegment(SDL_FPoint from, SDL_FPoint to) const {
+    return ::castSegment(Cursor{this}, from, to);
+}
+
+bool GridTree::lineOfSight(SDL_FPoint from, SDL_FPoint to) const {
+    return !this->castSegment(from, to).hit;
+}
+
+void GridTree::lineOfSight(std::span<const SightPair> pairs, std::span<uint8_t> out,
+                           ThreadPool* pool) const {
+    queryLineOfSight(Cursor{this}, pairs, out, pool);
+}
+
+void GridTree::lineOfSight(std::span<const SDL_FPoint> viewers, std::span<const SDL_FPoint> targets,
+                           std::span<uint8_t> out, ThreadPool* pool) const {
+    queryLineOfSight(Cursor{this}, viewers, targets, out, pool);
+}
 
-    // Exits the grid tree without hitting anything
-    return RayHit{.hit = false, .locus = SDL_FPoint{x, y}};
+TreeStats GridTree::stats() const {
+    TreeStats stats;
+    queryTreeStats(Cursor{this}, 0, stats);
+    stats.bytes = stats.nodes * sizeof(GridTree);
+    return stats;
 }
 
 std::string GridTree::graphviz() const {
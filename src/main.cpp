@@ -2,30 +2,123 @@
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL_main.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-
+#include <limits>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "beam_tracer.hpp"
+#include "column_sampler.hpp"
+#include "entity_tree.hpp"
+#include "flat_grid_tree.hpp"
+#include "frame_stats.hpp"
+#include "framebuffer.hpp"
 #include "grid_map.hpp"
 #include "grid_tree.hpp"
+#include "map_loader.hpp"
+#include "thread_pool.hpp"
+#include "tiled_world.hpp"
 #include "utils.hpp"
 
+#ifdef QUADCASTER_EMBEDDED_MAP
+#include "embedded_map.hpp"
+#endif
+
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 double lastFrame = 0.0;
 
+// Counts and timings of the frames, shown over the view or printed once per period when enabled
+FrameStats frameStats;
+TreeStats treeStats;
+bool showStats = false;
+bool dumpStats = false;
+
 GridMap map;
 GridTree grid;
+size_t gridSize = 1; // Blocks spanned by a side of the grid tree
+
+// Lets rays skip across the open space around the empty quadrants of `grid`, measured once built
+bool useClearance = false;
+
+// Builds text maps off the render thread, swapping each into the above between frames once done
+std::unique_ptr<MapLoader> loader;
+std::string mapFile;
+bool watchMap = false;
+
+enum class MapSource {
+    Text,     // Treeified into `grid`, which is editable
+    TreeFile, // Prebuilt grid tree file loaded into `flatGrid`
+    World,    // Tiles paged in by `world` as rays reach them
+    Embedded, // Compiled in as `EMBEDDED_MAP`, always cast through with the exact engine
+};
+MapSource mapSource = MapSource::Text;
+FlatGridTree flatGrid;
+TiledWorld world;
+
+CastEngine engine = CastEngine::Recursive;
+const char* engineName[] = {"recursive", "parametric", "roped", "exact"};
+std::unique_ptr<ThreadPool> pool;
+
+enum class RenderMode {
+    Lines,    // Submits a line per pixel column to the renderer
+    Software, // Fills a streaming texture on the CPU, submitted as a single draw
+};
+RenderMode renderMode = RenderMode::Lines;
+Framebuffer framebuffer;
+SDL_Texture* frameTexture = nullptr;
+
+std::vector<float> rayAngles;
+std::vector<RayHit> rayHits;
+
+// Casts only a few of the columns where neighbors agree, with `subsample` being the stride toggled to
+ColumnSampler sampler;
+size_t subsample = 4;
+size_t raysCast = 0;
+
+// Stops rays through text maps at nodes spanning fewer than `lodPixels` pixel columns, seen by their
+// representative color, with `levelOfDetail` toggling it
+float lodPixels = 1.0f;
+bool levelOfDetail = false;
+
+// Traces the view frustum as a whole rather than casting a ray per column, drawing a span per face seen
+BeamTracer beam;
+bool beamTracing = false;
+std::vector<SDL_Vertex> beamVertices;
+std::vector<int> beamIndices;
+
+// Sprites wandering about the map, culled against the depth of the wall in every column before any
+// draw is submitted
+EntityTree entities;
+std::vector<SDL_FPoint> entityVelocities;
+size_t entityCount = 0;
+std::vector<float> columnDepths;
+std::vector<EntityView> entityViews;
+size_t entitiesHidden = 0;
+
 struct {
     SDL_FPoint pos = {0.0, 0.0};
     float angle = 0.0; // In radians
 
-    float wall;
+    float wall = 0.0; // Fitted to the map once loaded, as is speed
     float fov = M_PI_2; // 90 degrees
 
-    float speed;
+    float speed = 0.0;
     float rot_speed = 2.0 * M_PI_2;
 } camera;
 
+// Adjusts wall height and player speed according to the map size
+void fitCamera(size_t mapWidth, size_t mapHeight) {
+    camera.wall = mapWidth > mapHeight ? 2.0 / mapWidth : 2.0 / mapHeight;
+    camera.speed = camera.wall * 2.0;
+}
+
 SDL_AppResult SDL_AppInit(void** app_state, int argc, char** argv) {
     // Initializes SDL along with a window
     if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -41,18 +134,226 @@ SDL_AppResult SDL_AppInit(void** app_state, int argc, char** argv) {
     // Enables v-sync
     SDL_SetRenderVSync(renderer, SDL_RENDERER_VSYNC_ADAPTIVE);
 
-    // Loads map
-    map = GridMap(argc >= 2 ? argv[1] : "maps/a.txt");
-    grid = map.treeify();
-    std::cout << grid.graphviz();
+    // Parses command line arguments, with the map file being the only positional one
+#ifdef QUADCASTER_EMBEDDED_MAP
+    std::string map_file = "embedded";
+#else
+    std::string map_file = "maps/a.txt";
+#endif
+    size_t workers = ThreadPool::defaultWorkers();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            engine = name == "parametric" ? CastEngine::Parametric
+                     : name == "roped"    ? CastEngine::Roped
+                     : name == "exact"    ? CastEngine::Exact
+                                          : CastEngine::Recursive;
+        }
+        else if (arg == "--software") {
+            renderMode = RenderMode::Software;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            // Counts the main thread in, as it casts alongside the workers
+            int threads = std::atoi(argv[++i]);
+            workers = threads > 1 ? threads - 1 : 0;
+        }
+        else if (arg == "--subsample" && i + 1 < argc) {
+            subsample = std::max(std::atoi(argv[++i]), 2);
+            sampler.stride = subsample;
+        }
+        else if (arg == "--beam") {
+            beamTracing = true;
+        }
+        else if (arg == "--clearance") {
+            useClearance = true;
+        }
+        else if (arg == "--stats") {
+            showStats = true;
+        }
+        else if (arg == "--stats-dump") {
+            dumpStats = true;
+        }
+        else if (arg == "--lod" && i + 1 < argc) {
+            float pixels = std::atof(argv[++i]);
+            levelOfDetail = pixels > 0.0f;
+            lodPixels = levelOfDetail ? pixels : lodPixels;
+        }
+        else if (arg == "--watch") {
+            watchMap = true;
+        }
+        else if (arg == "--entities" && i + 1 < argc) {
+            entityCount = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--tile-budget" && i + 1 < argc) {
+            world.budget = std::strtoull(argv[++i], nullptr, 10) << 20;
+        }
+        else if (arg == "--tile-miss" && i + 1 < argc) {
+            std::string name = argv[++i];
+            world.miss = name == "report" ? TileMiss::Report : TileMiss::Load;
+        }
+        else {
+            map_file = arg;
+        }
+    }
+
+    // Spawns the workers casting the pixel columns
+    pool = std::make_unique<ThreadPool>(workers);
 
-    // Adjusts wall height and player speed according to the map size
-    camera.wall = map.width > map.height ? 2.0 / map.width : 2.0 / map.height;
-    camera.speed = camera.wall * 2.0;
+    // Loads map, either as a tiled world, a prebuilt grid tree file or treeifying a text map
+#ifdef QUADCASTER_EMBEDDED_MAP
+    if (map_file == "embedded") {
+        // Nothing to load, the tree being in the program already
+        mapSource = MapSource::Embedded;
+        treeStats = EMBEDDED_MAP.stats();
+        fitCamera(EMBEDDED_MAP.width, EMBEDDED_MAP.height);
+    }
+    else
+#endif
+    if (map_file.ends_with(".qcw")) {
+        mapSource = MapSource::World;
+        if (!world.load(map_file)) {
+            return SDL_APP_FAILURE;
+        }
+        fitCamera(world.span(), world.span());
+    }
+    else if (map_file.ends_with(".qct")) {
+        mapSource = MapSource::TreeFile;
+        if (!flatGrid.load(map_file)) {
+            return SDL_APP_FAILURE;
+        }
+
+        // Links the leaves up front, only when walking along them
+        if (engine == CastEngine::Roped) {
+            flatGrid.rope();
+        }
+        treeStats = flatGrid.stats();
+        fitCamera(flatGrid.width, flatGrid.height);
+    }
+    else {
+        // Builds the tree off the render thread, drawing an empty view until it is swapped in
+        mapFile = map_file;
+        loader = std::make_unique<MapLoader>(workers);
+        loader->watch = watchMap;
+        loader->clearance = useClearance;
+        loader->load(mapFile);
+    }
+
+    // Falls back on the parametric engine for maps without ropes, rather than quietly casting with it
+    if (engine == CastEngine::Roped && !flatGrid.roped()) {
+        std::cerr << "The roped engine only walks through unshared grid tree files, casting with the "
+                     "parametric engine instead!\n";
+        engine = CastEngine::Parametric;
+    }
 
     return SDL_APP_CONTINUE;
 }
 
+// Swaps in the text map built since the last frame, if any, handing the one let go of back to the
+// loader to be torn down, as no frame casts through it anymore
+void adoptLoadedMap() {
+    std::unique_ptr<LoadedMap> loaded = loader ? loader->take() : nullptr;
+    if (!loaded) {
+        return;
+    }
+
+    std::swap(map, loaded->map);
+    std::swap(grid, loaded->tree);
+    std::swap(gridSize, loaded->size);
+    std::swap(treeStats, loaded->stats);
+    fitCamera(map.width, map.height);
+    loader->retire(std::move(loaded));
+}
+
+// Whether a circle there would overlap any block
+bool solidOverlaps(SDL_FPoint pos, float radius) {
+    switch (mapSource) {
+        case MapSource::Text:
+            return grid.overlapsCircle(pos, radius);
+        case MapSource::TreeFile:
+            return flatGrid.overlapsCircle(pos, radius);
+        case MapSource::World:
+            // Walks through tiles, which may not even be loaded yet
+            return false;
+        case MapSource::Embedded:
+#ifdef QUADCASTER_EMBEDDED_MAP
+            return EMBEDDED_MAP.overlapsCircle(pos, radius);
+#endif
+            break;
+    }
+
+    return false;
+}
+
+// Whether the camera, a quarter of a block across, would overlap any block there
+bool cameraBlocked(SDL_FPoint pos) {
+    return solidOverlaps(pos, camera.wall / 4.0f);
+}
+
+// Scatters the entities asked for over open space, once the size of the blocks is known
+void spawnEntities() {
+    std::mt19937 random(entities.size());
+    std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> heading(0.0f, 2.0f * M_PI);
+    std::uniform_int_distribution<int> color(1, sizeof(GRID_PALETTE) / sizeof(GRID_PALETTE[0]) - 1);
+
+    while (entities.size() < entityCount) {
+        Entity entity = {.radius = camera.wall * 0.3f, .color = GRID_PALETTE[color(random)]};
+        for (int attempt = 0; attempt < 16; attempt++) {
+            entity.pos = {coordinate(random), coordinate(random)};
+            if (!solidOverlaps(entity.pos, entity.radius)) {
+                break;
+            }
+        }
+        entities.add(entity);
+
+        float angle = heading(random);
+        float speed = camera.speed / 2.0f;
+        entityVelocities.push_back({std::sin(angle) * speed, std::cos(angle) * speed});
+    }
+}
+
+// Walks every entity ahead, bouncing off the bounds and blocks along either axis unless already stuck
+// within blocks
+void updateEntities(float deltaTime) {
+    for (uint32_t id = 0; id < entities.size(); id++) {
+        const Entity& entity = entities.get(id);
+        SDL_FPoint pos = entity.pos;
+        SDL_FPoint& velocity = entityVelocities[id];
+
+        bool stuck = solidOverlaps(pos, entity.radius);
+        SDL_FPoint next = {pos.x + velocity.x * deltaTime, pos.y + velocity.y * deltaTime};
+        if (std::abs(next.x) < 1.0f && (stuck || !solidOverlaps({next.x, pos.y}, entity.radius))) {
+            pos.x = next.x;
+        }
+        else {
+            velocity.x = -velocity.x;
+        }
+        if (std::abs(next.y) < 1.0f && (stuck || !solidOverlaps({pos.x, next.y}, entity.radius))) {
+            pos.y = next.y;
+        }
+        else {
+            velocity.y = -velocity.y;
+        }
+
+        entities.move(id, pos);
+    }
+}
+
+// Shows the settings in the window title, along with the frame rate over the last period
+void updateTitle() {
+    char title[256];
+    std::snprintf(title, sizeof(title),
+                  "Quadcaster (x: %f, y: %f, angle: %d, fov: %d, engine: %s, renderer: %s, "
+                  "subsample: %zu, tracing: %s, lod: %s) at %d FPS",
+                  camera.pos.x, camera.pos.y, (int)(camera.angle / M_PI * 180.0),
+                  (int)(camera.fov / M_PI * 180.0), engineName[(int)engine],
+                  renderMode == RenderMode::Software ? "software" : "lines", sampler.stride,
+                  beamTracing ? "beam" : "rays", levelOfDetail ? "on" : "off",
+                  (int)frameStats.summary.fps);
+    SDL_SetWindowTitle(window, title);
+}
+
 SDL_AppResult SDL_AppIterate(void* app_state) {
     /****★**********/
     /* Diagnostics */
@@ -60,13 +361,10 @@ SDL_AppResult SDL_AppIterate(void* app_state) {
 
     double deltaTime = (double)SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency() - lastFrame;
     lastFrame += deltaTime;
+    frameStats.begin();
 
-    std::string title = "Quadcaster (x: " + std::to_string(camera.pos.x) +
-                        ", y: " + std::to_string(camera.pos.y) +
-                        ", angle: " + std::to_string((int)(camera.angle / M_PI * 180.0)) +
-                        ", fov: " + std::to_string((int)(camera.fov / M_PI * 180.0)) + ") at " +
-                        std::to_string((int)(1.0 / deltaTime)) + " FPS";
-    SDL_SetWindowTitle(window, title.c_str());
+    // Picks up any map loaded in the meantime, between frames
+    adoptLoadedMap();
 
     /****★*************/
     /* Input handling */
@@ -78,21 +376,31 @@ SDL_AppResult SDL_AppIterate(void* app_state) {
     float sprint = keyboard[SDL_SCANCODE_LSHIFT] ? 2.0 : 1.0;
 
     // Camera movement
+    SDL_FPoint move = {0.0f, 0.0f};
     if (keyboard[SDL_SCANCODE_W]) {
-        camera.pos.x += std::sin(camera.angle) * camera.speed * sprint * deltaTime;
-        camera.pos.y += std::cos(camera.angle) * camera.speed * sprint * deltaTime;
+        move.x += std::sin(camera.angle) * camera.speed * sprint * deltaTime;
+        move.y += std::cos(camera.angle) * camera.speed * sprint * deltaTime;
     }
     if (keyboard[SDL_SCANCODE_A]) {
-        camera.pos.x += std::sin(camera.angle - M_PI_2) * camera.speed * sprint * deltaTime;
-        camera.pos.y += std::cos(camera.angle - M_PI_2) * camera.speed * sprint * deltaTime;
+        move.x += std::sin(camera.angle - M_PI_2) * camera.speed * sprint * deltaTime;
+        move.y += std::cos(camera.angle - M_PI_2) * camera.speed * sprint * deltaTime;
     }
     if (keyboard[SDL_SCANCODE_S]) {
-        camera.pos.x += std::sin(camera.angle + M_PI) * camera.speed * sprint * deltaTime;
-        camera.pos.y += std::cos(camera.angle + M_PI) * camera.speed * sprint * deltaTime;
+        move.x += std::sin(camera.angle + M_PI) * camera.speed * sprint * deltaTime;
+        move.y += std::cos(camera.angle + M_PI) * camera.speed * sprint * deltaTime;
     }
     if (keyboard[SDL_SCANCODE_D]) {
-        camera.pos.x += std::sin(camera.angle + M_PI_2) * camera.speed * sprint * deltaTime;
-        camera.pos.y += std::cos(camera.angle + M_PI_2) * camera.speed * sprint * deltaTime;
+        move.x += std::sin(camera.angle + M_PI_2) * camera.speed * sprint * deltaTime;
+        move.y += std::cos(camera.angle + M_PI_2) * camera.speed * sprint * deltaTime;
+    }
+
+    // Slides along walls by moving along either axis on its own, unless already stuck within blocks
+    bool stuck = cameraBlocked(camera.pos);
+    if (stuck || !cameraBlocked(SDL_FPoint{camera.pos.x + move.x, camera.pos.y})) {
+        camera.pos.x += move.x;
+    }
+    if (stuck || !cameraBlocked(SDL_FPoint{camera.pos.x, camera.pos.y + move.y})) {
+        camera.pos.y += move.y;
     }
 
     // Camera rotation
@@ -103,6 +411,12 @@ SDL_AppResult SDL_AppIterate(void* app_state) {
         camera.angle += camera.rot_speed * deltaTime;
     }
 
+    // Entities wait for the map to be loaded, sizing them
+    if (entities.size() < entityCount && camera.wall > 0.0f) {
+        spawnEntities();
+    }
+    updateEntities(deltaTime);
+
     /****★********/
     /* Rendering */
     /****★********/
@@ -111,43 +425,304 @@ SDL_AppResult SDL_AppIterate(void* app_state) {
     SDL_GetCurrentRenderOutputSize(renderer, &width, &height);
     float midpoint = height / 2.0;
 
-    // Sky color
-    SDL_SetRenderDrawColor(renderer, 128, 224, 255, 255);
-    SDL_FRect skyRect = {.x = 0, .y = 0, .w = (float)width, .h = midpoint};
-    SDL_RenderFillRect(renderer, &skyRect);
+    const SDL_Color sky = {128, 224, 255, 255};
+    const SDL_Color ground = {64, 128, 64, 255};
 
-    // Ground color
-    SDL_SetRenderDrawColor(renderer, 64, 128, 64, 255);
-    SDL_FRect groundRect = {.x = 0, .y = midpoint, .w = (float)width, .h = midpoint};
-    SDL_RenderFillRect(renderer, &groundRect);
+    if (renderMode == RenderMode::Lines) {
+        // Sky color
+        SDL_SetRenderDrawColor(renderer, sky.r, sky.g, sky.b, sky.a);
+        SDL_FRect skyRect = {.x = 0, .y = 0, .w = (float)width, .h = midpoint};
+        SDL_RenderFillRect(renderer, &skyRect);
+
+        // Ground color
+        SDL_SetRenderDrawColor(renderer, ground.r, ground.g, ground.b, ground.a);
+        SDL_FRect groundRect = {.x = 0, .y = midpoint, .w = (float)width, .h = midpoint};
+        SDL_RenderFillRect(renderer, &groundRect);
+    }
+    else if (framebuffer.width != width || framebuffer.height != height) {
+        // Recreates the streaming texture upon resizing
+        SDL_DestroyTexture(frameTexture);
+        frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XRGB8888,
+                                         SDL_TEXTUREACCESS_STREAMING, width, height);
+        framebuffer.resize(width, height);
+    }
 
     float cameraField = std::tan(camera.fov / 2.0);
     camera.angle = std::fmod(camera.angle, 2.0 * M_PI) + (camera.angle < 0.0 ? 2.0 * M_PI : 0.0);
 
-    // Raycasts for each pixel column in the screen
-    for (int x = 0; x < width; x++) {
+    // Depth of the wall in every column, as far as can be where none is
+    columnDepths.assign(width, std::numeric_limits<float>::infinity());
+    float wallScale = camera.wall * (width / 2.0) / cameraField; // Column length times depth
+
+    // Traces the whole view as a beam instead, on grid trees held in memory
+    bool tracing = beamTracing && mapSource != MapSource::World;
+    if (tracing) {
+        castStats = CastStats();
+        if (mapSource == MapSource::Text) {
+            grid.traceBeam(camera.pos, camera.angle, camera.fov, width, beam);
+        }
+#ifdef QUADCASTER_EMBEDDED_MAP
+        else if (mapSource == MapSource::Embedded) {
+            EMBEDDED_MAP.traceBeam(camera.pos, camera.angle, camera.fov, width, beam);
+        }
+#endif
+        else {
+            flatGrid.traceBeam(camera.pos, camera.angle, camera.fov, width, beam);
+        }
+        frameStats.gather(castStats);
+        frameStats.time(FramePhase::Cast);
+
+        if (renderMode == RenderMode::Software) {
+            for (int x = 0; x < width; x++) {
+                framebuffer.clearColumn(x);
+            }
+        }
+        beamVertices.clear();
+        beamIndices.clear();
+
+        for (const FaceSpan& span : beam.spans) {
+            // Lengths follow the inverse of the depth, which is linear across the face
+            float first = camera.wall / span.depths[0] * (width / 2.0) / cameraField;
+            float last = camera.wall / span.depths[1] * (width / 2.0) / cameraField;
+            int columns = span.end - span.begin;
+            float slope = columns > 1 ? (last - first) / (columns - 1) : 0.0f;
+            for (int x = span.begin; x < span.end; x++) {
+                columnDepths[x] = wallScale / (first + slope * (x - span.begin));
+            }
+
+            // Fills a column per pixel as the rays would, or submits a trapezoid over the whole span
+            if (renderMode == RenderMode::Software) {
+                for (int x = span.begin; x < span.end; x++) {
+                    float length = first + slope * (x - span.begin);
+                    framebuffer.setColumn(x, midpoint - length / 2.0, midpoint + length / 2.0,
+                                          span.color);
+                }
+                continue;
+            }
+
+            float end = first + slope * columns;
+            SDL_FColor color = {span.color.r / 255.0f, span.color.g / 255.0f, span.color.b / 255.0f,
+                                span.color.a / 255.0f};
+            int base = beamVertices.size();
+            beamVertices.push_back({{(float)span.begin, midpoint - first / 2.0f}, color});
+            beamVertices.push_back({{(float)span.end, midpoint - end / 2.0f}, color});
+            beamVertices.push_back({{(float)span.end, midpoint + end / 2.0f}, color});
+            beamVertices.push_back({{(float)span.begin, midpoint + first / 2.0f}, color});
+            for (int corner : {0, 1, 2, 0, 2, 3}) {
+                beamIndices.push_back(base + corner);
+            }
+        }
+
+        if (renderMode == RenderMode::Lines) {
+            SDL_RenderGeometry(renderer, nullptr, beamVertices.data(), beamVertices.size(),
+                               beamIndices.data(), beamIndices.size());
+        }
+    }
+    else {
         // Calculates the appropriate ray angle for each pixel column, taking account perspective
-        float cameraX = remap(x, 0.0, width, -1.0, 1.0);
-        float rayAngle = camera.angle + std::atan(cameraX * cameraField);
+        rayAngles.resize(width);
+        rayHits.resize(width);
+        for (int x = 0; x < width; x++) {
+            float cameraX = remap(x, 0.0, width, -1.0, 1.0);
+            rayAngles[x] = camera.angle + std::atan(cameraX * cameraField);
+        }
+
+        // Raycasts the columns asked for by the sampler in parallel, each range of columns at once
+        float footprint = levelOfDetail ? pixelFootprint(camera.fov, width, lodPixels) : 0.0f;
+        auto castColumns = [&](std::span<const float> columnAngles, std::span<RayHit> columnHits) {
+            pool->parallelFor(columnAngles.size(), 64, [&](size_t begin, size_t end) {
+                auto angles = columnAngles.subspan(begin, end - begin);
+                auto hits = columnHits.subspan(begin, end - begin);
+                castStats = CastStats();
+                switch (mapSource) {
+                    case MapSource::Text:
+                        grid.castBatch(camera.pos, angles, hits, engine, footprint);
+                        break;
+                    case MapSource::TreeFile:
+                        flatGrid.castBatch(camera.pos, angles, hits, engine);
+                        break;
+                    case MapSource::World:
+                        world.castBatch(camera.pos, angles, hits, engine);
+                        break;
+                    case MapSource::Embedded:
+#ifdef QUADCASTER_EMBEDDED_MAP
+                        EMBEDDED_MAP.castBatch(camera.pos, angles, hits);
+#endif
+                        break;
+                }
+                frameStats.gather(castStats);
+            });
+        };
+
+        // Looks for anything in front of the faces the sampler fills columns in along, which worlds
+        // can't tell without paging their tiles in, hence every column is cast through them
+        auto occluded = [&](SDL_FPoint a, SDL_FPoint b, SDL_FPoint c) {
+            switch (mapSource) {
+                case MapSource::Text:
+                    return grid.overlapsTriangle(a, b, c);
+                case MapSource::TreeFile:
+                    return flatGrid.overlapsTriangle(a, b, c);
+                case MapSource::World:
+                    return true;
+                case MapSource::Embedded:
+#ifdef QUADCASTER_EMBEDDED_MAP
+                    return EMBEDDED_MAP.overlapsTriangle(a, b, c);
+#endif
+                    break;
+            }
+            return true;
+        };
+        raysCast = sampler.cast(camera.pos, rayAngles, rayHits, castColumns, occluded);
+
+        // Pages in a few of the tiles rays missed, spreading the loading over frames
+        if (mapSource == MapSource::World) {
+            world.pageRequested(4);
+        }
+        frameStats.time(FramePhase::Cast);
+
+        // Submits the draws on the main thread
+        for (int x = 0; x < width; x++) {
+            // Checks for the ray's success
+            const RayHit& ray = rayHits[x];
+            if (!ray.hit) {
+                if (renderMode == RenderMode::Software) {
+                    framebuffer.clearColumn(x);
+                }
+                continue;
+            }
 
-        // Casts the ray and checks for its success
-        RayHit ray = grid.cast(camera.pos, rayAngle);
-        if (ray.hit) {
             float distance = std::sqrt(std::pow(ray.locus.x - camera.pos.x, 2.0) +
                                        std::pow(ray.locus.y - camera.pos.y, 2.0)) *
-                             std::cos(rayAngle - camera.angle); // Undoes the fish-eye effect
+                             std::cos(rayAngles[x] - camera.angle); // Undoes the fish-eye effect
             float length = camera.wall / distance * (width / 2.0) / cameraField;
+            columnDepths[x] = distance;
 
             // Draws the pixel column whose length is determined on the distance inverse
-            SDL_SetRenderDrawColor(renderer, ray.color.r, ray.color.g, ray.color.b, ray.color.a);
-            SDL_RenderLine(renderer, x, midpoint - length / 2.0, x, midpoint + length / 2.0);
+            if (renderMode == RenderMode::Lines) {
+                SDL_SetRenderDrawColor(renderer, ray.color.r, ray.color.g, ray.color.b, ray.color.a);
+                SDL_RenderLine(renderer, x, midpoint - length / 2.0, x, midpoint + length / 2.0);
+            }
+            else {
+                framebuffer.setColumn(x, midpoint - length / 2.0, midpoint + length / 2.0, ray.color);
+            }
+        }
+    }
+
+    // Fills the whole frame on the CPU, uploaded as a single texture draw
+    if (renderMode == RenderMode::Software) {
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture(frameTexture, nullptr, &pixels, &pitch)) {
+            pool->parallelFor(height, 32, [&](size_t begin, size_t end) {
+                framebuffer.render((uint32_t*)pixels, pitch, sky, ground, begin, end);
+            });
+            SDL_UnlockTexture(frameTexture);
+        }
+
+        SDL_RenderTexture(renderer, frameTexture, nullptr, nullptr);
+    }
+
+    // Draws the sprites left in view farthest first, over the runs of columns their walls leave open,
+    // standing on the ground and as tall as they are wide
+    if (entities.size() > 0) {
+        entities.queryFrustum(camera.pos, camera.angle, camera.fov, width,
+                              std::numeric_limits<float>::infinity(), entityViews);
+        entitiesHidden = cullOccluded(entityViews, columnDepths);
+
+        for (auto view = entityViews.rbegin(); view != entityViews.rend(); view++) {
+            SDL_Color color = entities.get(view->entity).color;
+            SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+
+            float bottom = midpoint + wallScale / view->depth / 2.0f;
+            float size = view->half_width * 2.0f;
+            int begin = std::max((int)std::floor(view->column - view->half_width), 0);
+            int end = std::min((int)std::ceil(view->column + view->half_width), width);
+            for (int x = begin; x < end;) {
+                if (columnDepths[x] <= view->depth) {
+                    x++;
+                    continue;
+                }
+
+                int run = x;
+                while (x < end && columnDepths[x] > view->depth) {
+                    x++;
+                }
+                SDL_FRect rect = {(float)run, bottom - size, (float)(x - run), size};
+                SDL_RenderFillRect(renderer, &rect);
+            }
         }
     }
 
+    // Counts the rays actually cast this frame, or the faces traced
+    std::string counter = tracing ? std::to_string(beam.spans.size()) + " faces"
+                                  : std::to_string(raysCast) + " / " + std::to_string(width) + " rays";
+    if (entities.size() > 0) {
+        counter += ", " + std::to_string(entityViews.size()) + " sprites (" +
+                   std::to_string(entitiesHidden) + " hidden)";
+    }
+    if (loader && loader->loading()) {
+        counter += " (loading map)";
+    }
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDebugText(renderer, 8.0f, 8.0f, counter.c_str());
+
+    // Shows what the frames took below, over the last period
+    if (showStats) {
+        frameStats.draw(renderer, 8.0f, 24.0f, mapSource == MapSource::World ? nullptr : &treeStats);
+    }
+    frameStats.time(FramePhase::Draw);
+
     SDL_RenderPresent(renderer);
+    frameStats.time(FramePhase::Present);
+
+    // Refreshes the title and prints the stats once per period rather than every frame
+    if (frameStats.endFrame()) {
+        updateTitle();
+        if (dumpStats) {
+            std::cout << frameStats.json(mapSource == MapSource::World ? nullptr : &treeStats) << '\n';
+        }
+    }
     return SDL_APP_CONTINUE;
 }
 
+void editBlockAhead(bool build) {
+    // Grid tree files, worlds and embedded maps are immutable
+    if (mapSource != MapSource::Text) {
+        return;
+    }
+
+    RayHit ray = grid.cast(camera.pos, camera.angle, engine);
+    if (!ray.hit) {
+        return;
+    }
+
+    // Steps a quarter of a block into the wall hit, or back out of it to build in front
+    float step = (build ? -0.5f : 0.5f) / gridSize;
+    float x = ray.locus.x + std::sin(camera.angle) * step;
+    float y = ray.locus.y + std::cos(camera.angle) * step;
+    float blockX = std::floor((x + 1.0f) / 2.0f * gridSize);
+    float blockY = std::floor((1.0f - y) / 2.0f * gridSize);
+    if (blockX < 0.0f || blockY < 0.0f) {
+        return;
+    }
+
+    SDL_Color color = build ? GRID_PALETTE[1] : SDL_Color{0, 0, 0, 0};
+    size_t size = grid.setCell(gridSize, blockX, blockY, color, useClearance);
+
+    // Keeps the camera over the same blocks as the grid grows, whose blocks shrink in the meantime
+    for (; gridSize < size; gridSize *= 2) {
+        camera.pos.x = (camera.pos.x + 1.0f) / 2.0f - 1.0f;
+        camera.pos.y = 1.0f - (1.0f - camera.pos.y) / 2.0f;
+        camera.wall /= 2.0f;
+        camera.speed /= 2.0f;
+    }
+
+    // Only measured when shown, as the whole tree is walked through
+    if (showStats || dumpStats) {
+        treeStats = grid.stats();
+    }
+}
+
 SDL_AppResult SDL_AppEvent(void* app_state, SDL_Event* event) {
     switch (event->type) {
         // Concludes the program on quitting
@@ -165,14 +740,87 @@ SDL_AppResult SDL_AppEvent(void* app_state, SDL_Event* event) {
                     camera.fov += M_PI / 180.0 * 5.0;
                     break;
 
+                // Cycles through the raycasting engines
+                case SDL_SCANCODE_E: {
+                    size_t engines = sizeof(engineName) / sizeof(engineName[0]);
+                    engine = (CastEngine)(((size_t)engine + 1) % engines);
+
+                    // Walks along ropes only through grid tree files, linking their leaves on first use
+                    if (engine == CastEngine::Roped) {
+                        bool treeFile = mapSource == MapSource::TreeFile;
+                        if (treeFile && !flatGrid.shared() && !flatGrid.roped()) {
+                            flatGrid.rope();
+                            treeStats = flatGrid.stats();
+                        }
+                        if (!treeFile || !flatGrid.roped()) {
+                            engine = CastEngine::Exact;
+                        }
+                    }
+                    break;
+                }
+
+                // Toggles between submitting lines and software rendering
+                case SDL_SCANCODE_R:
+                    renderMode = renderMode == RenderMode::Lines ? RenderMode::Software
+                                                                 : RenderMode::Lines;
+                    break;
+
+                // Toggles between casting every column and subsampling them
+                case SDL_SCANCODE_T:
+                    sampler.stride = sampler.stride > 1 ? 1 : subsample;
+                    break;
+
+                // Toggles between casting a ray per column and tracing the view as a beam
+                case SDL_SCANCODE_V:
+                    beamTracing = !beamTracing;
+                    break;
+
+                // Toggles between refining every node down to its leaves and stopping at the footprint
+                case SDL_SCANCODE_O:
+                    levelOfDetail = !levelOfDetail;
+                    break;
+
+                // Toggles the overlay of frame and traversal stats
+                case SDL_SCANCODE_I:
+                    showStats = !showStats;
+                    if (showStats && mapSource == MapSource::Text) {
+                        treeStats = grid.stats();
+                    }
+                    break;
+
+                // Breaks the block in the middle of the view, or builds one in front of it
+                case SDL_SCANCODE_F:
+                    editBlockAhead(false);
+                    break;
+
+                case SDL_SCANCODE_B:
+                    editBlockAhead(true);
+                    break;
+
+                // Loads the text map again in the background, dropping any edits
+                case SDL_SCANCODE_L:
+                    if (loader) {
+                        loader->load(mapFile);
+                    }
+                    break;
+
                 default:
                     // Appeases compiler warnings
                     break;
             }
+
+            // Shows any setting changed without waiting for the period to be over
+            updateTitle();
             break;
     }
 
     return SDL_APP_CONTINUE;
 }
 
-void SDL_AppQuit(void* app_state, SDL_AppResult result) {}
+void SDL_AppQuit(void* app_state, SDL_AppResult result) {
+    // Joins the workers before the globals they use go away
+    pool.reset();
+    loader.reset();
+
+    SDL_DestroyTexture(frameTexture);
+}
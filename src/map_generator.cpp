@@ -0,0 +1,210 @@
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "map_generator.hpp"
+
+
+bool parseMapKind(const std::string& name, MapKind& kind) {
+    for (MapKind candidate : {MapKind::Noise, MapKind::Maze, MapKind::Caves, MapKind::Rooms}) {
+        if (name == mapKindName(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* mapKindName(MapKind kind) {
+    switch (kind) {
+        case MapKind::Noise:
+            return "noise";
+        case MapKind::Maze:
+            return "maze";
+        case MapKind::Caves:
+            return "caves";
+        case MapKind::Rooms:
+            return "rooms";
+    }
+
+    return "unknown";
+}
+
+static GridMap generateNoise(size_t size, float density, std::mt19937& rng) {
+    GridMap map(size, size);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    std::uniform_int_distribution<int> color(1, 7);
+
+    for (size_t y = 0; y < size; y++) {
+        for (size_t x = 0; x < size; x++) {
+            if (chance(rng) < density) {
+                map.setAt(x, y, color(rng));
+            }
+        }
+    }
+
+    return map;
+}
+
+static GridMap generateMaze(size_t size, float density, std::mt19937& rng) {
+    GridMap map(size, size);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+    // Starts out solid, with the passages carved at odd coordinates
+    for (size_t y = 0; y < size; y++) {
+        for (size_t x = 0; x < size; x++) {
+            map.setAt(x, y, 1);
+        }
+    }
+    if (size < 3) {
+        return map;
+    }
+
+    // Carves a perfect maze by backtracking depth-first, with an explicit stack
+    size_t cells = (size - 1) / 2;
+    std::vector<bool> visited(cells * cells, false);
+    std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+    visited[0] = true;
+    map.setAt(1, 1, 0);
+
+    while (!stack.empty()) {
+        auto [cx, cy] = stack.back();
+
+        // Gathers the unvisited neighbors
+        std::pair<size_t, size_t> neighbors[4];
+        int count = 0;
+        if (cx > 0 && !visited[cy * cells + cx - 1]) {
+            neighbors[count++] = {cx - 1, cy};
+        }
+        if (cx + 1 < cells && !visited[cy * cells + cx + 1]) {
+            neighbors[count++] = {cx + 1, cy};
+        }
+        if (cy > 0 && !visited[(cy - 1) * cells + cx]) {
+            neighbors[count++] = {cx, cy - 1};
+        }
+        if (cy + 1 < cells && !visited[(cy + 1) * cells + cx]) {
+            neighbors[count++] = {cx, cy + 1};
+        }
+
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        // Knocks down the wall in between
+        auto [nx, ny] = neighbors[std::uniform_int_distribution<int>(0, count - 1)(rng)];
+        visited[ny * cells + nx] = true;
+        map.setAt(2 * nx + 1, 2 * ny + 1, 0);
+        map.setAt(cx + nx + 1, cy + ny + 1, 0);
+        stack.push_back({nx, ny});
+    }
+
+    // Punches loops into the inner walls
+    for (size_t y = 1; y + 1 < size; y++) {
+        for (size_t x = 1; x + 1 < size; x++) {
+            if ((x + y) % 2 == 1 && chance(rng) < density) {
+                map.setAt(x, y, 0);
+            }
+        }
+    }
+
+    return map;
+}
+
+static GridMap generateCaves(size_t size, float density, std::mt19937& rng) {
+    // Seeds denser noise than asked for, as smoothing wears sparse blocks away
+    GridMap noise = generateNoise(size, 0.35f + density / 2.0f, rng);
+
+    // Smooths the noise, where blocks with enough solid neighbors become solid
+    std::vector<uint8_t> cells(size * size), next(size * size);
+    for (size_t y = 0; y < size; y++) {
+        for (size_t x = 0; x < size; x++) {
+            cells[y * size + x] = noise.getAt(x, y) != 0;
+        }
+    }
+
+    for (int step = 0; step < 4; step++) {
+        for (size_t y = 0; y < size; y++) {
+            for (size_t x = 0; x < size; x++) {
+                int solid = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        size_t nx = x + dx;
+                        size_t ny = y + dy;
+
+                        // The outside counts as solid, closing the caves off
+                        solid += nx >= size || ny >= size || cells[ny * size + nx];
+                    }
+                }
+                next[y * size + x] = solid >= 5;
+            }
+        }
+        std::swap(cells, next);
+    }
+
+    GridMap map(size, size);
+    for (size_t y = 0; y < size; y++) {
+        for (size_t x = 0; x < size; x++) {
+            if (cells[y * size + x]) {
+                map.setAt(x, y, 1 + (x / 16 + y / 16) % 7);
+            }
+        }
+    }
+
+    return map;
+}
+
+static GridMap generateRooms(size_t size, float density, std::mt19937& rng) {
+    GridMap map(size, size);
+    if (size < 8) {
+        return map;
+    }
+
+    std::uniform_int_distribution<size_t> position(0, size - 1);
+    std::uniform_int_distribution<size_t> extent(4, std::max<size_t>(4, size / 16));
+    std::uniform_int_distribution<int> color(1, 7);
+
+    // Lays out as many rooms as needed to roughly cover the density
+    size_t average = 4 + std::max<size_t>(4, size / 16);
+    size_t rooms = (size_t)(density * size * size / (average * average / 4.0f)) + 1;
+    for (size_t i = 0; i < rooms; i++) {
+        size_t x0 = position(rng), y0 = position(rng);
+        size_t x1 = std::min(size - 1, x0 + extent(rng));
+        size_t y1 = std::min(size - 1, y0 + extent(rng));
+        uint8_t type = color(rng);
+
+        // Hollow walls
+        for (size_t x = x0; x <= x1; x++) {
+            map.setAt(x, y0, type);
+            map.setAt(x, y1, type);
+        }
+        for (size_t y = y0; y <= y1; y++) {
+            map.setAt(x0, y, type);
+            map.setAt(x1, y, type);
+        }
+
+        // Doorways through the middle of the horizontal walls
+        map.setAt((x0 + x1) / 2, y0, 0);
+        map.setAt((x0 + x1) / 2, y1, 0);
+    }
+
+    return map;
+}
+
+GridMap generateMap(MapKind kind, size_t size, float density, uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    switch (kind) {
+        case MapKind::Noise:
+            return generateNoise(size, density, rng);
+        case MapKind::Maze:
+            return generateMaze(size, density, rng);
+        case MapKind::Caves:
+            return generateCaves(size, density, rng);
+        case MapKind::Rooms:
+            return generateRooms(size, density, rng);
+    }
+
+    return GridMap(size, size);
+}
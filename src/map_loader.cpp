@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "map_loader.hpp"
+#include "utils.hpp"
+
+
+// How often the loader looks for changes to the watched file, when it can't sleep on them
+static const auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+
+MapLoader::MapLoader(size_t workers) : pool(std::make_unique<ThreadPool>(workers)) {
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    this->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+#ifndef __EMSCRIPTEN__
+    this->thread = std::thread(&MapLoader::run, this);
+#endif
+}
+
+MapLoader::~MapLoader() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->stopping = true;
+    }
+    this->notify();
+    if (this->thread.joinable()) {
+        this->thread.join();
+    }
+
+    delete this->ready.exchange(nullptr);
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    if (this->notify_fd >= 0) {
+        close(this->notify_fd);
+    }
+    if (this->wake_fd >= 0) {
+        close(this->wake_fd);
+    }
+#endif
+}
+
+void MapLoader::load(const std::string& file_name) {
+    this->busy = true;
+#ifdef __EMSCRIPTEN__
+    // Threads aren't available without building for shared memory
+    this->build(file_name);
+    this->busy = false;
+#else
+    {
+        std::lock_guard lock(this->mutex);
+        this->requested = file_name;
+    }
+    this->notify();
+#endif
+}
+
+std::unique_ptr<LoadedMap> MapLoader::take() {
+    return std::unique_ptr<LoadedMap>(this->ready.exchange(nullptr));
+}
+
+void MapLoader::retire(std::unique_ptr<LoadedMap> map) {
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard lock(this->mutex);
+        this->graveyard.push_back(std::move(map));
+    }
+    this->notify();
+#endif
+}
+
+bool MapLoader::loading() const {
+    return this->busy;
+}
+
+void MapLoader::run() {
+    std::unique_lock lock(this->mutex);
+    while (!this->stopping) {
+        // Tears down the maps let go of first, which may well be the largest allocations around
+        if (!this->graveyard.empty()) {
+            auto dead = std::move(this->graveyard);
+            this->graveyard.clear();
+            lock.unlock();
+            dead.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (!this->requested.empty()) {
+            std::string file_name = std::exchange(this->requested, std::string());
+            lock.unlock();
+            this->build(file_name);
+            lock.lock();
+            this->busy = !this->requested.empty();
+            continue;
+        }
+
+        if (this->watched.empty()) {
+            this->wake.wait(lock);
+            continue;
+        }
+
+        bool changed = this->waitForChange(lock);
+        if (changed && !this->stopping && this->requested.empty()) {
+            std::cout << "Map `" << this->watched.string() << "` changed, loading it again\n";
+            this->requested = this->watched.string();
+            this->busy = true;
+        }
+    }
+}
+
+void MapLoader::notify() {
+    this->wake.notify_all();
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    if (this->wake_fd >= 0) {
+        uint64_t count = 1;
+        [[maybe_unused]] ssize_t written = write(this->wake_fd, &count, sizeof(count));
+    }
+#endif
+}
+
+void MapLoader::build(const std::string& file_name) {
+    if (this->watch) {
+        this->watchFile(file_name);
+    }
+
+    // Keeps the current map rather than swapping in an empty one, as files may be missing for a while
+    auto loaded = std::make_unique<LoadedMap>();
+    loaded->file_name = file_name;
+    loaded->map = GridMap(file_name);
+    if (loaded->map.width == 0 || loaded->map.height == 0) {
+        std::cerr << "Map `" << file_name << "` is empty!\n";
+        return;
+    }
+
+    if (this->pool) {
+        loaded->tree = loaded->map.treeify(*this->pool);
+        this->pool.reset();
+    }
+    else {
+        loaded->tree = loaded->map.treeify();
+    }
+    loaded->size = nextPowerOfTwo(std::max(loaded->map.width, loaded->map.height));
+    if (this->clearance) {
+        loaded->tree.measureClearance();
+    }
+    loaded->stats = loaded->tree.stats();
+
+    // Publishes the map, dropping any built before which the renderer didn't get to
+    delete this->ready.exchange(loaded.release());
+}
+
+void MapLoader::watchFile(const std::string& file_name) {
+    std::filesystem::path path = std::filesystem::absolute(file_name);
+    std::error_code error;
+    this->modified = std::filesystem::last_write_time(path, error);
+    if (path == this->watched) {
+        return;
+    }
+    this->watched = path;
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    // Watches the directory rather than the file, which editors often replace with a new one
+    if (this->notify_fd < 0) {
+        this->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+    if (this->notify_fd >= 0) {
+        if (this->watch_fd >= 0) {
+            inotify_rm_watch(this->notify_fd, this->watch_fd);
+        }
+        std::string directory = path.parent_path().string();
+        this->watch_fd = inotify_add_watch(this->notify_fd, directory.c_str(),
+                                           IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+    if (this->watch_fd < 0) {
+        std::cerr << "Failed to watch `" << path.string() << "`, polling it instead\n";
+    }
+#endif
+}
+
+bool MapLoader::waitForChange(std::unique_lock<std::mutex>& lock) {
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    if (this->watch_fd >= 0 && this->wake_fd >= 0) {
+        // Sleeps until the directory sees any event, or until anything else is asked of the loader
+        lock.unlock();
+        pollfd fds[2] = {{this->notify_fd, POLLIN, 0}, {this->wake_fd, POLLIN, 0}};
+        bool changed = false;
+        if (poll(fds, 2, -1) > 0) {
+            if (fds[1].revents & POLLIN) {
+                uint64_t count;
+                [[maybe_unused]] ssize_t length = read(this->wake_fd, &count, sizeof(count));
+            }
+            changed = (fds[0].revents & POLLIN) && this->fileChanged();
+        }
+        lock.lock();
+        return changed;
+    }
+#endif
+
+    this->wake.wait_for(lock, WATCH_INTERVAL);
+    if (this->stopping || !this->requested.empty()) {
+        return false;
+    }
+
+    lock.unlock();
+    bool changed = this->fileChanged();
+    lock.lock();
+    return changed;
+}
+
+bool MapLoader::fileChanged() {
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    if (this->watch_fd >= 0) {
+        // Drains every pending event, looking for any about the file
+        alignas(inotify_event) char buffer[4096];
+        std::string name = this->watched.filename().string();
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(this->notify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* at = buffer; at < buffer + length;) {
+                auto event = (const inotify_event*)at;
+                changed |= event->len > 0 && name == event->name;
+                at += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(this->watched, error);
+    if (error || modified == this->modified) {
+        return false;
+    }
+
+    this->modified = modified;
+    return true;
+}
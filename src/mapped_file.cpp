@@ -0,0 +1,70 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+
+MappedFile::MappedFile(const std::string& file_name) {
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open file `" << file_name << "`!\n";
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            this->bytes = (const uint8_t*)address;
+            this->length = info.st_size;
+            this->mapped = true;
+        }
+    }
+
+    // The mapping stays valid past closing its descriptor
+    close(fd);
+    if (this->mapped) {
+        return;
+    }
+#endif
+
+    // Falls back to reading the whole file
+    std::ifstream fstr(file_name, std::ios::binary);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to open file `" << file_name << "`!\n";
+        return;
+    }
+
+    this->buffer.assign(std::istreambuf_iterator<char>(fstr), std::istreambuf_iterator<char>());
+    this->bytes = this->buffer.data();
+    this->length = this->buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+    if (this->mapped) {
+        munmap((void*)this->bytes, this->length);
+    }
+#endif
+}
+
+bool MappedFile::isOpen() const {
+    return this->bytes != nullptr;
+}
+
+const uint8_t* MappedFile::data() const {
+    return this->bytes;
+}
+
+size_t MappedFile::size() const {
+    return this->length;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+
+ThreadPool::ThreadPool(size_t workers) {
+    for (size_t i = 0; i <= workers; i++) {
+        this->queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+        this->threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::defaultWorkers() {
+#ifdef __EMSCRIPTEN__
+    // Threads aren't available without building for shared memory
+    return 0;
+#else
+    // Leaves one hardware thread to the caller, which works alongside the pool
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+#endif
+}
+
+size_t ThreadPool::size() const {
+    return this->threads.size();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain,
+                             const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    // Runs inline when there's nothing to share
+    if (this->threads.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    // Deals the chunks out to every queue in turn
+    size_t chunks = (count + grain - 1) / grain;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->job = &body;
+        this->pending = chunks;
+
+        for (size_t i = 0; i < chunks; i++) {
+            Queue& queue = *this->queues[i % this->queues.size()];
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            queue.chunks.push_back({i * grain, std::min(count, (i + 1) * grain)});
+        }
+
+        this->generation++;
+    }
+    this->wake.notify_all();
+
+    // Helps out with its own queue, before waiting on the chunks still in flight
+    this->work(this->threads.size());
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [this] { return this->pending == 0; });
+    this->job = nullptr;
+}
+
+void ThreadPool::run(size_t index) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [&] { return this->stopping || this->generation != seen; });
+            if (this->stopping) {
+                return;
+            }
+
+            seen = this->generation;
+        }
+
+        this->work(index);
+    }
+}
+
+bool ThreadPool::take(size_t index, std::pair<size_t, size_t>& chunk) {
+    // Pops off the front of its own queue
+    {
+        Queue& queue = *this->queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.chunks.empty()) {
+            chunk = queue.chunks.front();
+            queue.chunks.pop_front();
+            return true;
+        }
+    }
+
+    // Steals off the back of the other queues
+    for (size_t i = 1; i < this->queues.size(); i++) {
+        Queue& queue = *this->queues[(index + i) % this->queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.chunks.empty()) {
+            chunk = queue.chunks.back();
+            queue.chunks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::work(size_t index) {
+    std::pair<size_t, size_t> chunk;
+    while (this->take(index, chunk)) {
+        // The job outlives every chunk still pending
+        (*this->job)(chunk.first, chunk.second);
+
+        if (--this->pending == 0) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->done.notify_all();
+        }
+    }
+}
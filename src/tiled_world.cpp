@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "tiled_world.hpp"
+#include "utils.hpp"
+
+
+bool TiledWorld::load(const std::string& file_name) {
+    std::ifstream fstr(file_name);
+    if (!fstr.is_open()) {
+        std::cerr << "Failed to open world file `" << file_name << "`!\n";
+        return false;
+    }
+
+    std::string keyword;
+    int version = 0;
+    if (!(fstr >> keyword >> version) || keyword != "quadcaster-world" || version != 1) {
+        std::cerr << "File `" << file_name << "` is not a world of a supported version!\n";
+        return false;
+    }
+
+    // Reads every field by its keyword, with the tiles being laid out before any is referenced
+    std::filesystem::path directory = std::filesystem::path(file_name).parent_path();
+    std::vector<Tile> tiles;
+    size_t tile_size = 0, columns = 0, rows = 0;
+    while (fstr >> keyword) {
+        if (keyword == "tile_size") {
+            fstr >> tile_size;
+        }
+        else if (keyword == "tiles") {
+            fstr >> columns >> rows;
+            tiles = std::vector<Tile>(columns * rows);
+        }
+        else if (keyword == "tile") {
+            size_t x, y;
+            std::string tile_file;
+            if (!(fstr >> x >> y >> tile_file) || x >= columns || y >= rows) {
+                std::cerr << "World `" << file_name << "` refers to a tile out of its bounds!\n";
+                return false;
+            }
+
+            tiles[y * columns + x].file_name = (directory / tile_file).string();
+        }
+        else {
+            std::cerr << "World `" << file_name << "` has an unknown field `" << keyword << "`!\n";
+            return false;
+        }
+    }
+
+    if (tile_size == 0 || nextPowerOfTwo(tile_size) != tile_size || tiles.empty()) {
+        std::cerr << "World `" << file_name << "` lacks tiles of a power of two size!\n";
+        return false;
+    }
+
+    std::lock_guard lock(this->mutex);
+    this->tiles = std::move(tiles);
+    this->tile_size = tile_size;
+    this->columns = columns;
+    this->rows = rows;
+    this->recent.clear();
+    this->resident_size = 0;
+    this->requests.clear();
+    return true;
+}
+
+size_t TiledWorld::span() const {
+    return this->tile_size * std::max(this->columns, this->rows);
+}
+
+size_t TiledWorld::residentTiles() {
+    std::lock_guard lock(this->mutex);
+    return this->recent.size();
+}
+
+size_t TiledWorld::residentBytes() {
+    std::lock_guard lock(this->mutex);
+    return this->resident_size;
+}
+
+size_t TiledWorld::pageRequested(size_t limit) {
+    std::vector<size_t> pending;
+    {
+        std::lock_guard lock(this->mutex);
+        size_t count = std::min(limit, this->requests.size());
+        pending.assign(this->requests.begin(), this->requests.begin() + count);
+        this->requests.erase(this->requests.begin(), this->requests.begin() + count);
+    }
+
+    // Reads the tiles without holding up the rays being cast meanwhile
+    for (size_t index : pending) {
+        auto tree = std::make_shared<FlatGridTree>();
+        bool loaded = tree->load(this->tiles[index].file_name);
+
+        std::lock_guard lock(this->mutex);
+        this->tiles[index].requested = false;
+        if (loaded) {
+            this->insert(index, std::move(tree));
+        }
+        else {
+            this->tiles[index].broken = true;
+        }
+    }
+
+    return pending.size();
+}
+
+const TiledWorld::Lookup& TiledWorld::lookup(size_t index, Lookups& lookups) {
+    auto found = lookups.find(index);
+    if (found != lookups.end()) {
+        return found->second;
+    }
+
+    Lookup& lookup = lookups[index];
+    lookup.tree = this->acquire(index, lookup.missed);
+    return lookup;
+}
+
+std::shared_ptr<const FlatGridTree> TiledWorld::acquire(size_t index, bool& missed) {
+    // Skips the tiles left out without locking, as file names never change while casting
+    if (this->tiles[index].file_name.empty()) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard lock(this->mutex);
+        Tile& tile = this->tiles[index];
+
+        // Marks resident tiles as the most recently used
+        if (tile.tree) {
+            this->recent.splice(this->recent.begin(), this->recent, tile.recent);
+            return tile.tree;
+        }
+
+        if (tile.broken) {
+            return nullptr;
+        }
+
+        if (this->miss == TileMiss::Report) {
+            if (!tile.requested) {
+                tile.requested = true;
+                this->requests.push_back(index);
+            }
+            missed = true;
+            return nullptr;
+        }
+    }
+
+    // Pages the tile in outside of the lock, with its file name never changing while casting
+    auto tree = std::make_shared<FlatGridTree>();
+    bool loaded = tree->load(this->tiles[index].file_name);
+
+    std::lock_guard lock(this->mutex);
+    if (!loaded) {
+        this->tiles[index].broken = true;
+        return nullptr;
+    }
+
+    this->insert(index, std::move(tree));
+    return this->tiles[index].tree;
+}
+
+void TiledWorld::insert(size_t index, std::shared_ptr<const FlatGridTree> tree) {
+    // Keeps the copy paged in first by another ray
+    Tile& tile = this->tiles[index];
+    if (tile.tree) {
+        return;
+    }
+
+    tile.tree = std::move(tree);
+    tile.recent = this->recent.insert(this->recent.begin(), index);
+    this->resident_size += tile.tree->bytes();
+
+    // Evicts the least recently used tiles over the budget, though rays still hold onto theirs
+    while (this->resident_size > this->budget && this->recent.size() > 1) {
+        Tile& evicted = this->tiles[this->recent.back()];
+        this->resident_size -= evicted.tree->bytes();
+        evicted.tree.reset();
+        this->recent.pop_back();
+    }
+}
+
+RayHit TiledWorld::cast(SDL_FPoint origin, float angle, CastEngine engine) {
+    Lookups lookups;
+    return this->cast(origin, angle, engine, lookups);
+}
+
+RayHit TiledWorld::cast(SDL_FPoint origin, float angle, CastEngine engine, Lookups& lookups) {
+    float dx = std::sin(angle);
+    float dy = std::cos(angle);
+
+    if (this->tiles.empty()) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+
+    // Side of a tile, and the far corner of the world
+    float side = 2.0f / std::max(this->columns, this->rows);
+    float x_end = -1.0f + this->columns * side;
+    float y_end = 1.0f - this->rows * side;
+
+    // Slab entry and exit of the whole world
+    float t_enter = 0.0f;
+    float t_exit = INF;
+    if (dx != 0.0f) {
+        float t0 = (-1.0f - origin.x) / dx;
+        float t1 = (x_end - origin.x) / dx;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
+    }
+    else if (origin.x < -1.0f || origin.x > x_end) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+    if (dy != 0.0f) {
+        float t0 = (y_end - origin.y) / dy;
+        float t1 = (1.0f - origin.y) / dy;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
+    }
+    else if (origin.y < y_end || origin.y > 1.0f) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+    if (t_enter > t_exit) {
+        return RayHit{.hit = false, .locus = origin};
+    }
+
+    // Tile on entry, leaning towards the direction of travel on its boundaries
+    float u = (origin.x + t_enter * dx + 1.0f) / side;
+    float v = (1.0f - origin.y - t_enter * dy) / side;
+    long column = std::floor(u) - (u == std::floor(u) && dx < 0.0f);
+    long row = std::floor(v) - (v == std::floor(v) && dy > 0.0f);
+    column = std::clamp(column, 0l, (long)this->columns - 1);
+    row = std::clamp(row, 0l, (long)this->rows - 1);
+
+    // Walks through the tiles along the ray, rows growing towards Y-
+    float t = t_enter;
+    while (true) {
+        const Lookup& tile = this->lookup(row * this->columns + column, lookups);
+        const std::shared_ptr<const FlatGridTree>& tree = tile.tree;
+        if (tile.missed) {
+            SDL_FPoint locus = {origin.x + t * dx, origin.y + t * dy};
+            return RayHit{.hit = false, .locus = locus, .missed = true};
+        }
+
+        if (tree && !tree->empty()) {
+            // Casts from where the ray entered the tile, in the tile's own coordinates
+            SDL_FPoint center = {-1.0f + (column + 0.5f) * side, 1.0f - (row + 0.5f) * side};
+            float scale = side / 2.0f;
+            SDL_FPoint local = {std::clamp((origin.x + t * dx - center.x) / scale, -1.0f, 1.0f),
+                                std::clamp((origin.y + t * dy - center.y) / scale, -1.0f, 1.0f)};
+
+            RayHit hit = tree->cast(local, angle, engine);
+            if (hit.hit) {
+                hit.locus = SDL_FPoint{center.x + hit.locus.x * scale, center.y + hit.locus.y * scale};
+                hit.leaf = SDL_FPoint{center.x + hit.leaf.x * scale, center.y + hit.leaf.y * scale};
+                return hit;
+            }
+        }
+
+        // Steps into whichever neighbor the ray reaches first
+        float t_column = dx != 0.0f ? (-1.0f + (column + (dx > 0.0f)) * side - origin.x) / dx : INF;
+        float t_row = dy != 0.0f ? (1.0f - (row + (dy < 0.0f)) * side - origin.y) / dy : INF;
+        if (t_column <= t_row) {
+            column += dx > 0.0f ? 1 : -1;
+        }
+        else {
+            row += dy < 0.0f ? 1 : -1;
+        }
+
+        t = std::max(t, std::min(t_column, t_row));
+        if (t >= t_exit || column < 0 || column >= (long)this->columns || row < 0 ||
+            row >= (long)this->rows) {
+            break;
+        }
+    }
+
+    // Exits the world without hitting anything
+    return RayHit{.hit = false, .locus = SDL_FPoint{origin.x + t_exit * dx, origin.y + t_exit * dy}};
+}
+
+void TiledWorld::castBatch(SDL_FPoint origin, std::span<const float> angles, std::span<RayHit> out,
+                           CastEngine engine) {
+    // Holds onto every tile the rays go through until the whole batch is cast, so that rays sharing
+    // tiles never contend for the cache's lock more than once per tile
+    Lookups lookups;
+    size_t count = std::min(angles.size(), out.size());
+    for (size_t i = 0; i < count; i++) {
+        out[i] = this->cast(origin, angles[i], engine, lookups);
+    }
+}